@@ -1,6 +1,12 @@
 #include "doctest.h"
 #include "sources/MagicalContainer.hpp"
+#include "sources/PrimalityKernel.hpp"
+#include "sources/PrimalityOracle.hpp"
+#include <algorithm>
+#include <climits>
+#include <numeric>
 #include <stdexcept>
+#include <thread>
 
 using namespace ariel;
 using namespace std;
@@ -596,3 +602,1252 @@ TEST_CASE("operator= throws when iterators are pointing at different containers"
    }
 }
 
+
+// Test case for the prefix-sum queries, with and without the Fenwick index
+TEST_CASE("Prefix sums over the container") {
+    MagicalContainer container;
+    for (int value : {10, 3, 7, 2, 5, 11, 4}) {
+        container.addElement(value);
+    }
+
+    SUBCASE("Linear fallback") {
+        CHECK_FALSE(container.hasSumIndex());
+        CHECK(container.sumOfSmallest(3) == 9);
+        CHECK(container.sumInRange(4, 10) == 26);
+        CHECK(container.primeSumOfSmallest(2) == 5);
+        CHECK(container.primeSumInRange(3, 11) == 26);
+    }
+
+    SUBCASE("Fenwick index kept up to date") {
+        container.enableSumIndex(true);
+        CHECK(container.sumOfSmallest(3) == 9);
+        CHECK(container.sumInRange(4, 10) == 26);
+        container.addElement(13);
+        container.removeElement(2);
+        CHECK(container.sumOfSmallest(0) == 0);
+        CHECK(container.sumOfSmallest(container.size()) == 53);
+        CHECK(container.primeSumOfSmallest(2) == 8);
+        CHECK(container.primeSumInRange(4, 13) == 36);
+        CHECK(container.sumInRange(20, 10) == 0);
+        CHECK_THROWS_AS(container.sumOfSmallest(9), out_of_range);
+    }
+}
+
+// Test case for the rank, select and quantile queries
+TEST_CASE("Order statistics") {
+    MagicalContainer container;
+    for (int value : {8, 3, 5, 1, 9, 2, 6}) {
+        container.addElement(value);
+    }
+
+    CHECK(container.rank(5) == 3);
+    CHECK(container.rank(0) == 0);
+    CHECK(container.rank(100) == 7);
+    CHECK(container.select(0) == 1);
+    CHECK(container.select(6) == 9);
+    CHECK(container.quantile(0.0) == 1);
+    CHECK(container.quantile(0.5) == 5);
+    CHECK(container.quantile(1.0) == 9);
+    CHECK(container.median() == 5.0);
+    CHECK(container.countInRange(2, 6) == 4);
+    CHECK(container.primeRank(6) == 3);
+    CHECK(container.primeSelect(1) == 3);
+
+    container.addElement(4);
+    CHECK(container.median() == 4.5);
+    CHECK_THROWS_AS(container.select(8), out_of_range);
+    CHECK_THROWS_AS(container.primeSelect(3), out_of_range);
+    CHECK_THROWS_AS(container.quantile(1.5), invalid_argument);
+    CHECK_THROWS_AS(MagicalContainer().median(), out_of_range);
+}
+
+// Test case for the predecessor, successor and nearest-value queries
+TEST_CASE("Neighbour queries") {
+    MagicalContainer container;
+    for (int value : {1, 4, 6, 7, 10, 15, 20}) {
+        container.addElement(value);
+    }
+
+    CHECK(container.predecessor(6) == 4);
+    CHECK(container.successor(6) == 7);
+    CHECK(container.nearest(12) == 10);
+    CHECK(container.nearest(5) == 4);
+    CHECK(container.kNearest(8, 3) == vector<int>{7, 6, 10});
+    CHECK(container.kNearest(0, 10).size() == 7);
+    CHECK_THROWS_AS(container.predecessor(1), out_of_range);
+    CHECK_THROWS_AS(container.successor(20), out_of_range);
+
+
+    container.addElement(3);
+    container.addElement(13);
+    CHECK(container.primePredecessor(7) == 3);
+    CHECK(container.primeSuccessor(7) == 13);
+    CHECK(container.nearestPrime(9) == 7);
+    CHECK(container.kNearestPrimes(11, 2) == vector<int>{13, 7});
+    CHECK_THROWS_AS(container.primeSuccessor(13), out_of_range);
+}
+
+// Test case for the non-throwing lookup API
+TEST_CASE("Membership lookups") {
+    MagicalContainer container;
+    for (int value : {5, 1, 5, 9, 5}) {
+        container.addElement(value);
+    }
+
+    CHECK(container.contains(9));
+    CHECK_FALSE(container.contains(4));
+    CHECK(container.count(5) == 3);
+    CHECK(container.count(4) == 0);
+
+    MagicalContainer::AscendingIterator found = container.find(5);
+    CHECK(*found == 5);
+    ++found;
+    ++found;
+    ++found;
+    CHECK(*found == 9);
+    CHECK(container.find(7) == found.end());
+
+    int value = 0;
+    CHECK(container.tryGet(4, value));
+    CHECK(value == 9);
+    CHECK_FALSE(container.tryGet(5, value));
+    CHECK(value == 9);
+    CHECK(container.tryRemoveElement(5));
+    CHECK_FALSE(container.tryRemoveElement(4));
+    CHECK(container.size() == 4);
+}
+
+// Test case for the branchless search and the Eytzinger read index
+TEST_CASE("Search accelerators agree with a linear scan") {
+    MagicalContainer container;
+    for (int i = 0; i < 300; ++i) {
+        container.addElement((i * 37) % 101 - 50);
+    }
+
+    SUBCASE("Branchless search") {
+        CHECK_FALSE(container.hasReadIndex());
+        for (int key = -55; key <= 55; ++key) {
+            vector<int> elements = container.getElements();
+            size_t expected = static_cast<size_t>(lower_bound(elements.begin(), elements.end(), key) - elements.begin());
+            CHECK(container.rank(key) == expected);
+        }
+    }
+
+    SUBCASE("Eytzinger index rebuilt after mutations") {
+        container.enableReadIndex(true);
+        CHECK(container.count(0) == 3);
+        container.addElement(0);
+        container.removeElement(50);
+        CHECK(container.count(0) == 4);
+        vector<int> elements = container.getElements();
+        for (int key = -55; key <= 55; ++key) {
+            size_t expected = static_cast<size_t>(lower_bound(elements.begin(), elements.end(), key) - elements.begin());
+            CHECK(container.rank(key) == expected);
+        }
+        container.enableReadIndex(false);
+        CHECK(container.contains(-50));
+    }
+}
+
+// Test case for the learned index, including lookups after mutations and outside the model
+TEST_CASE("Learned index agrees with a linear scan") {
+    MagicalContainer container;
+    container.enableLearnedIndex(true, 4, 8);
+    CHECK(container.hasLearnedIndex());
+    for (int i = 0; i < 500; ++i) {
+        container.addElement(i * 3);
+    }
+    container.addElement(10000);
+    container.addElement(-10000);
+
+    for (int round = 0; round < 3; ++round) {
+        vector<int> elements = container.getElements();
+        for (int key = -20; key <= 1520; key += 7) {
+            size_t expected = static_cast<size_t>(lower_bound(elements.begin(), elements.end(), key) - elements.begin());
+            CHECK(container.rank(key) == expected);
+        }
+        CHECK(container.rank(20000) == elements.size());
+        CHECK(container.contains(10000));
+        CHECK_FALSE(container.contains(2));
+        container.removeElement(round * 300);
+        container.addElement(round * 300 + 1);
+    }
+}
+
+// Test case for the batched lookups, in both the sparse and the dense regime
+TEST_CASE("Batched lookups") {
+    MagicalContainer container;
+    for (int i = 0; i < 2000; ++i) {
+        container.addElement(i * 2);
+    }
+
+    SUBCASE("Sparse batch uses interleaved searches") {
+        vector<int> keys{-1, 0, 5, 3998, 4000, 1000, 17};
+        vector<size_t> ranks(keys.size());
+        bool found[7] = {};
+        container.rankBatch(keys, ranks);
+        container.containsBatch(keys, found);
+        for (size_t i = 0; i < keys.size(); ++i) {
+            CHECK(ranks[i] == container.rank(keys[i]));
+            CHECK(found[i] == container.contains(keys[i]));
+        }
+    }
+
+    SUBCASE("Dense batch uses a merge-join") {
+        vector<int> keys;
+        for (int key = 4100; key >= -100; key -= 3) {
+            keys.push_back(key);
+        }
+        vector<size_t> ranks(keys.size());
+        container.rankBatch(keys, ranks);
+        for (size_t i = 0; i < keys.size(); ++i) {
+            CHECK(ranks[i] == container.rank(keys[i]));
+        }
+        CHECK_THROWS_AS(container.rankBatch(keys, span<size_t>(ranks.data(), 1)), invalid_argument);
+    }
+}
+
+// Test case for the bulk removal API
+TEST_CASE("Bulk removal") {
+    MagicalContainer container;
+    for (int value = 1; value <= 10; ++value) {
+        container.addElement(value);
+    }
+    container.addElement(5);
+
+    SUBCASE("Removing a list of values") {
+        vector<int> victims{5, 2, 42, 5, 5, 10};
+        CHECK(container.removeElements(victims) == 2);
+        CHECK(container.getElements() == vector<int>{1, 3, 4, 6, 7, 8, 9});
+        MagicalContainer::PrimeIterator it(container);
+        CHECK(*it == 3);
+        ++it;
+        CHECK(*it == 7);
+    }
+
+    SUBCASE("Removing by predicate") {
+        CHECK(container.removeIf([](int value) { return value % 2 == 0; }) == 5);
+        CHECK(container.getElements() == vector<int>{1, 3, 5, 5, 7, 9});
+    }
+
+    SUBCASE("Removing a value range") {
+        CHECK(container.removeRange(4, 7) == 5);
+        CHECK(container.removeRange(4, 7) == 0);
+        CHECK(container.getElements() == vector<int>{1, 2, 3, 8, 9, 10});
+        CHECK(container.primeSelect(1) == 3);
+    }
+}
+
+// Test case for tombstone deletion, compared against a plain sorted vector while compactions run
+TEST_CASE("Tombstone deletion with incremental compaction") {
+    MagicalContainer container;
+    container.setTombstoneMode(true, 0.2, 3);
+    container.enableSumIndex(true);
+    CHECK(container.hasTombstoneMode());
+    vector<int> expected;
+    for (int i = 0; i < 120; ++i) {
+        container.addElement(i % 40);
+        expected.push_back(i % 40);
+    }
+    sort(expected.begin(), expected.end());
+
+    unsigned seed = 7;
+    for (int round = 0; round < 200; ++round) {
+        seed = seed * 1103515245 + 12345;
+        int value = static_cast<int>((seed >> 8) % 45);
+        auto it = lower_bound(expected.begin(), expected.end(), value);
+        bool present = it != expected.end() && *it == value;
+        if (present) {
+            expected.erase(it);
+        }
+        CHECK(container.tryRemoveElement(value) == present);
+        REQUIRE(container.size() == expected.size());
+    }
+    CHECK(container.tombstoneCount() > 0);
+    CHECK(container.getElements() == expected);
+
+    long long total = 0;
+    vector<int> primes;
+    for (size_t i = 0; i < expected.size(); ++i) {
+        CHECK(container[i] == expected[i]);
+        total += expected[i];
+        if (container.isPrime(expected[i])) {
+            primes.push_back(expected[i]);
+        }
+    }
+    CHECK(container.sumOfSmallest(expected.size()) == total);
+    CHECK(container.primeSumInRange(0, 100) == accumulate(primes.begin(), primes.end(), 0LL));
+
+    vector<int> visited;
+    MagicalContainer::PrimeIterator primeIt(container);
+    for (auto it = primeIt.begin(); it != primeIt.end(); ++it) {
+        visited.push_back(*it);
+    }
+    CHECK(visited == primes);
+
+    MagicalContainer::SideCrossIterator crossIt(container);
+    CHECK(*crossIt == expected.front());
+    ++crossIt;
+    CHECK(*crossIt == expected.back());
+
+    container.addElement(1000);
+    CHECK(container.tombstoneCount() == 0);
+    CHECK(container.size() == expected.size() + 1);
+    container.setTombstoneMode(false);
+    CHECK_THROWS_AS(container.removeElement(-1), runtime_error);
+}
+
+// Test case for the insert buffer: reads always see the merged, sorted view
+TEST_CASE("Buffered inserts with deferred merge") {
+    MagicalContainer container;
+    container.setInsertBuffer(true, 4);
+    CHECK(container.hasInsertBuffer());
+
+    container.addElement(9);
+    container.addElement(2);
+    container.addElement(7);
+    CHECK(container.pendingInsertCount() == 3);
+    CHECK(container.tryRemoveElement(7));
+    CHECK(container.pendingInsertCount() == 2);
+
+    SUBCASE("Merged when the buffer fills") {
+        container.addElement(5);
+        container.addElement(3);
+        container.addElement(11);
+        container.addElement(4);
+        CHECK(container.pendingInsertCount() == 2);
+        CHECK(container.getElements() == vector<int>{2, 3, 4, 5, 9, 11});
+    }
+
+    SUBCASE("Merged by the next read") {
+        MagicalContainer::PrimeIterator it(container);
+        container.addElement(3);
+        CHECK(*it == 2);
+        ++it;
+        CHECK(*it == 3);
+        CHECK(container.pendingInsertCount() == 0);
+        container.addElement(1);
+        CHECK(container[0] == 1);
+        container.addElement(10);
+        CHECK(container.size() == 5);
+        container.addElement(0);
+        CHECK(container.rank(5) == 4);
+    }
+}
+
+// Test case for the log-structured layout: every query goes through the backend's rank and select
+TEST_CASE("Log-structured storage layout") {
+    MagicalContainer container;
+    for (int i = 0; i < 300; ++i)
+    {
+        container.addElement((i * 37) % 101);
+    }
+    vector<int> expected = container.getElements();
+    container.setStorageLayout(MagicalContainer::StorageLayout::LogStructured);
+    CHECK(container.storageLayout() == MagicalContainer::StorageLayout::LogStructured);
+    CHECK(container.getElements() == expected);
+
+    for (int i = 0; i < 500; ++i)
+    {
+        int value = (i * 53) % 211;
+        container.addElement(value);
+        expected.insert(upper_bound(expected.begin(), expected.end(), value), value);
+    }
+    for (int i = 0; i < 200; ++i)
+    {
+        int value = (i * 29) % 251;
+        auto it = lower_bound(expected.begin(), expected.end(), value);
+        bool present = it != expected.end() && *it == value;
+        CHECK(container.tryRemoveElement(value) == present);
+        if (present)
+        {
+            expected.erase(it);
+        }
+    }
+    CHECK(container.size() == expected.size());
+    CHECK(container.getElements() == expected);
+    CHECK(container.rank(100) == static_cast<size_t>(lower_bound(expected.begin(), expected.end(), 100) - expected.begin()));
+    CHECK(container.select(expected.size() / 2) == expected[expected.size() / 2]);
+
+    // Reads interleaved with writes, in order, backwards and at random
+    for (int i = 0; i < 50; ++i)
+    {
+        int value = (i * 71) % 307 - 20;
+        container.addElement(value);
+        expected.insert(upper_bound(expected.begin(), expected.end(), value), value);
+        size_t k = static_cast<size_t>(i * 13) % expected.size();
+        CHECK(container.select(k) == expected[k]);
+        CHECK(container.select(expected.size() - 1 - k) == expected[expected.size() - 1 - k]);
+        CHECK(container.rank(value) == static_cast<size_t>(lower_bound(expected.begin(), expected.end(), value) - expected.begin()));
+    }
+    vector<int> ordered;
+    for (size_t k = 0; k < container.size(); ++k)
+    {
+        ordered.push_back(container.select(k));
+    }
+    CHECK(ordered == expected);
+
+    vector<int> primes;
+    copy_if(expected.begin(), expected.end(), back_inserter(primes), [&container](int value) { return container.isPrime(value); });
+    vector<int> iterated;
+    MagicalContainer::PrimeIterator prime(container);
+    for (auto it = prime.begin(); it != prime.end(); ++it)
+    {
+        iterated.push_back(*it);
+    }
+    CHECK(iterated == primes);
+    CHECK(container.primeRank(50) == static_cast<size_t>(lower_bound(primes.begin(), primes.end(), 50) - primes.begin()));
+
+    CHECK(container.removeRange(10, 20) == static_cast<size_t>(upper_bound(expected.begin(), expected.end(), 20) - lower_bound(expected.begin(), expected.end(), 10)));
+    CHECK(container.countInRange(10, 20) == 0);
+    CHECK_THROWS_AS(container.enableSumIndex(true), logic_error);
+    CHECK_THROWS_AS(container.setTombstoneMode(true), logic_error);
+
+    expected = container.getElements();
+    container.setStorageLayout(MagicalContainer::StorageLayout::SortedVector);
+    CHECK(container.getElements() == expected);
+    container.enableSumIndex(true);
+    CHECK(container.hasSumIndex());
+}
+
+// Test case for the run-length layout: duplicates only bump a counter
+TEST_CASE("Run-length storage layout") {
+    MagicalContainer container;
+    container.setStorageLayout(MagicalContainer::StorageLayout::RunLength);
+    for (int i = 0; i < 1000; ++i)
+    {
+        container.addElement(i % 4 == 0 ? 7 : i % 3);
+    }
+    CHECK(container.size() == 1000);
+    CHECK(container.count(7) == 250);
+    CHECK(container.count(0) == 250);
+    CHECK(container.count(1) == 250);
+    CHECK(container.count(2) == 250);
+    CHECK(container[249] == 0);
+    CHECK(container[250] == 1);
+    CHECK(container[999] == 7);
+    CHECK(container.rank(7) == 750);
+    CHECK(container.median() == 1.5);
+
+    MagicalContainer::AscendingIterator it(container);
+    size_t sevens = 0;
+    for (auto current = it.begin(); current != it.end(); ++current)
+    {
+        sevens += (*current == 7) ? 1U : 0U;
+    }
+    CHECK(sevens == 250);
+
+    for (int i = 0; i < 250; ++i)
+    {
+        CHECK(container.tryRemoveElement(2));
+    }
+    CHECK_FALSE(container.tryRemoveElement(2));
+    CHECK(container.size() == 750);
+    CHECK(container.primeRank(8) == 250);
+    container.addElement(2);
+    CHECK(container[500] == 2);
+    CHECK(container.primeSelect(0) == 2);
+    CHECK(container.primeSelect(1) == 7);
+}
+
+// Test case for unique mode: addElement reports whether the value went in
+TEST_CASE("Unique-set mode") {
+    MagicalContainer container;
+    for (int value : {4, 4, 9, 1, 9, 9})
+    {
+        CHECK(container.addElement(value));
+    }
+    CHECK(container.setUniqueMode(true) == 3);
+    CHECK(container.hasUniqueMode());
+    CHECK(container.getElements() == vector<int>{1, 4, 9});
+
+    CHECK_FALSE(container.addElement(4));
+    CHECK(container.addElement(5));
+    CHECK_FALSE(container.addElement(5));
+    CHECK(container.size() == 4);
+
+    CHECK(container.tryRemoveElement(5));
+    CHECK_FALSE(container.tryRemoveElement(5));
+    CHECK(container.addElement(5));
+
+    int batch[] = {1, 2};
+    CHECK(container.removeElements(batch) == 1);
+    CHECK(container.addElement(1));
+    CHECK(container.removeRange(4, 5) == 2);
+    CHECK(container.addElement(4));
+    CHECK(container.removeIf([](int value) { return value > 5; }) == 1);
+    CHECK(container.addElement(9));
+    CHECK(container.getElements() == vector<int>{1, 4, 9});
+
+    SUBCASE("Without the hash filter") {
+        container.setUniqueMode(true, false);
+        CHECK_FALSE(container.addElement(9));
+        CHECK(container.addElement(10));
+        CHECK(container.size() == 4);
+    }
+
+    SUBCASE("Under another storage layout") {
+        container.setStorageLayout(MagicalContainer::StorageLayout::RunLength);
+        CHECK_FALSE(container.addElement(1));
+        CHECK(container.addElement(2));
+        CHECK(container.getElements() == vector<int>{1, 2, 4, 9});
+    }
+
+    SUBCASE("Back to multiset semantics") {
+        container.setUniqueMode(false);
+        CHECK(container.addElement(9));
+        CHECK(container.count(9) == 2);
+    }
+}
+
+// Test case for the membership filter: misses are answered without false negatives
+TEST_CASE("Membership filter for lookup misses") {
+    MagicalContainer container;
+    for (int i = 0; i < 200; ++i)
+    {
+        container.addElement(2 * i);
+    }
+    container.enableMembershipFilter(true);
+    CHECK(container.hasMembershipFilter());
+
+    // Growing past the filter's sizing refills it
+    for (int i = 200; i < 2000; ++i)
+    {
+        container.addElement(2 * i);
+    }
+    for (int i = 0; i < 4000; ++i)
+    {
+        CHECK(container.contains(i) == (i % 2 == 0));
+    }
+    CHECK_FALSE(container.tryRemoveElement(7));
+    CHECK_THROWS_AS(container.removeElement(7), runtime_error);
+    CHECK(container.count(8) == 1);
+    CHECK(container.find(9) == MagicalContainer::AscendingIterator(container).end());
+
+    CHECK(container.tryRemoveElement(8));
+    CHECK_FALSE(container.contains(8));
+    container.addElement(8);
+    container.addElement(8);
+    CHECK(container.count(8) == 2);
+    CHECK(container.tryRemoveElement(8));
+    CHECK(container.contains(8));
+
+    int batch[] = {0, 2, 3};
+    CHECK(container.removeElements(batch) == 1);
+    CHECK(container.removeIf([](int value) { return value % 4 == 0; }) == 999);
+    CHECK(container.removeRange(100, 200) == 25);
+    CHECK_FALSE(container.contains(0));
+    CHECK_FALSE(container.contains(4));
+    CHECK_FALSE(container.contains(102));
+    CHECK(container.contains(6));
+    CHECK(container.contains(202));
+
+    container.enableMembershipFilter(false);
+    CHECK(container.contains(6));
+}
+
+// Test case for the dense layout: bitmap rank/select and the prime mask
+TEST_CASE("Dense-domain storage layout") {
+    MagicalContainer container;
+    for (int value : {10, 3, 7, 7, 20, 11})
+    {
+        container.addElement(value);
+    }
+    container.setStorageLayout(MagicalContainer::StorageLayout::Dense);
+    CHECK(container.storageLayout() == MagicalContainer::StorageLayout::Dense);
+    CHECK(container.getElements() == vector<int>{3, 7, 7, 10, 11, 20});
+    CHECK(container[2] == 7);
+    CHECK(container.rank(10) == 3);
+    CHECK(container.count(7) == 2);
+
+    // Values outside the starting range widen the domain
+    container.addElement(1000);
+    container.addElement(-50);
+    container.addElement(7);
+    CHECK(container.getElements() == vector<int>{-50, 3, 7, 7, 7, 10, 11, 20, 1000});
+    CHECK(container.tryRemoveElement(7));
+    CHECK_FALSE(container.tryRemoveElement(8));
+    CHECK_FALSE(container.tryRemoveElement(5000));
+
+    vector<int> primes;
+    MagicalContainer::PrimeIterator prime(container);
+    for (auto it = prime.begin(); it != prime.end(); ++it)
+    {
+        primes.push_back(*it);
+    }
+    CHECK(primes == vector<int>{3, 7, 7, 11});
+    CHECK(container.primeRank(11) == 3);
+    CHECK(container.nearestPrime(9) == 7);
+
+    vector<int> crossed;
+    MagicalContainer::SideCrossIterator cross(container);
+    for (auto it = cross.begin(); it != cross.end(); ++it)
+    {
+        crossed.push_back(*it);
+    }
+    CHECK(crossed == vector<int>{-50, 1000, 3, 20, 7, 11, 7, 10});
+
+    CHECK_THROWS_AS(container.addElement(INT_MAX), out_of_range);
+    CHECK(container.size() == 8);
+
+    MagicalContainer wide;
+    wide.addElement(INT_MIN);
+    wide.addElement(INT_MAX);
+    CHECK_THROWS_AS(wide.setStorageLayout(MagicalContainer::StorageLayout::Dense), invalid_argument);
+    CHECK(wide.storageLayout() == MagicalContainer::StorageLayout::SortedVector);
+    CHECK(wide.size() == 2);
+}
+
+// Test case for the Roaring layout: clustered values compress, positional access still works
+TEST_CASE("Roaring storage layout") {
+    MagicalContainer container;
+    vector<int> expected;
+    for (int i = 0; i < 200000; ++i)
+    {
+        expected.push_back(i);
+    }
+    for (int i = 1; i <= 50; ++i)
+    {
+        expected.push_back(i * 1000003);
+        expected.push_back(-i * 7919);
+    }
+    sort(expected.begin(), expected.end());
+    container.setStorageLayout(MagicalContainer::StorageLayout::Roaring);
+    for (int value : expected)
+    {
+        container.addElement(value);
+    }
+    CHECK(container.getElements() == expected);
+
+    // Moving through the sorted vector re-encodes the chunks as runs
+    size_t insertedBytes = container.memoryUsage();
+    container.setStorageLayout(MagicalContainer::StorageLayout::SortedVector);
+    size_t vectorBytes = container.memoryUsage();
+    container.setStorageLayout(MagicalContainer::StorageLayout::Roaring);
+    CHECK(container.memoryUsage() * 4 < vectorBytes);
+    CHECK(container.memoryUsage() < insertedBytes);
+    CHECK(container.getElements() == expected);
+    CHECK(container[50] == 0);
+    CHECK(container[150] == 100);
+    CHECK(container.rank(0) == 50);
+    CHECK(container.primeRank(100) == 25);
+
+    // Punch holes into the run of consecutive values, and add duplicates
+    size_t removed = 0;
+    for (int i = 0; i < 200000; i += 3)
+    {
+        removed += container.tryRemoveElement(i) ? 1U : 0U;
+    }
+    CHECK(removed == 66667);
+    container.addElement(7);
+    container.addElement(7);
+    container.addElement(-7919);
+    CHECK_FALSE(container.tryRemoveElement(3));
+    CHECK(container.count(7) == 3);
+    CHECK(container.count(-7919) == 2);
+
+    expected = container.getElements();
+    CHECK(is_sorted(expected.begin(), expected.end()));
+    CHECK(container.size() == expected.size());
+    for (size_t k = 0; k < expected.size(); k += 997)
+    {
+        CHECK(container[k] == expected[k]);
+    }
+
+    vector<int> crossed;
+    MagicalContainer::SideCrossIterator cross(container);
+    for (auto it = cross.begin(); it != cross.end() && crossed.size() < 4; ++it)
+    {
+        crossed.push_back(*it);
+    }
+    CHECK(crossed == vector<int>{expected[0], expected.back(), expected[1], expected[expected.size() - 2]});
+}
+
+// Test case for the adaptive layout: migrations follow the workload and never change the results
+TEST_CASE("Adaptive storage layout") {
+    MagicalContainer container;
+    container.enableSumIndex(true);
+    CHECK_THROWS_AS(container.setAdaptiveLayout(true), logic_error);
+    container.enableSumIndex(false);
+    container.setAdaptiveLayout(true, 512);
+    CHECK(container.hasAdaptiveLayout());
+    CHECK_THROWS_AS(container.enableReadIndex(true), logic_error);
+
+    // An ingest-heavy phase moves the elements out of the sorted vector
+    vector<int> expected;
+    for (int i = 0; i < 5000; ++i)
+    {
+        int value = (i * 7919) % 100003 * 31;
+        container.addElement(value);
+        expected.insert(upper_bound(expected.begin(), expected.end(), value), value);
+    }
+    CHECK(container.storageLayout() != MagicalContainer::StorageLayout::SortedVector);
+    CHECK(container.getElements() == expected);
+
+    // Iteration across a migration keeps its position
+    MagicalContainer::AscendingIterator it(container);
+    auto current = it.begin();
+    vector<int> iterated;
+    for (size_t i = 0; i < 100; ++i, ++current)
+    {
+        iterated.push_back(*current);
+    }
+    for (int i = 0; i < 2000; ++i)
+    {
+        CHECK(container.rank(expected[static_cast<size_t>(i)]) == static_cast<size_t>(i));
+    }
+    for (; current != it.end(); ++current)
+    {
+        iterated.push_back(*current);
+    }
+    CHECK(iterated == expected);
+
+    container.setAdaptiveLayout(false);
+    MagicalContainer::StorageLayout settled = container.storageLayout();
+    for (int i = 0; i < 3000; ++i)
+    {
+        container.addElement(i);
+    }
+    CHECK(container.storageLayout() == settled);
+    CHECK(container.size() == 8000);
+
+    // A dense layout picked by the adaptation gives way to values it cannot hold
+    MagicalContainer dense;
+    for (int i = 0; i < 1000; ++i)
+    {
+        dense.addElement(i);
+    }
+    dense.setAdaptiveLayout(true, 64);
+    for (int i = 0; i < 300; ++i)
+    {
+        dense.removeElement(i);
+        dense.addElement(i);
+    }
+    CHECK(dense.storageLayout() == MagicalContainer::StorageLayout::Dense);
+    CHECK(dense.addElement(INT_MAX));
+    CHECK(dense.addElement(INT_MIN));
+    CHECK(dense.size() == 1002);
+    CHECK(dense[0] == INT_MIN);
+    CHECK(dense[1001] == INT_MAX);
+    CHECK(dense.storageLayout() != MagicalContainer::StorageLayout::Dense);
+}
+
+// Test case for the frozen layout: read queries answer from the Elias-Fano encoding and mutations are rejected
+TEST_CASE("Frozen Elias-Fano storage") {
+    MagicalContainer container;
+    container.setStorageLayout(MagicalContainer::StorageLayout::RunLength);
+    vector<int> expected;
+    for (int i = 0; i < 3000; ++i)
+    {
+        int value = (i * 7919) % 20011 - 5000;
+        container.addElement(value);
+        container.addElement(value / 4 * 4);
+        expected.push_back(value);
+        expected.push_back(value / 4 * 4);
+    }
+    sort(expected.begin(), expected.end());
+    size_t thawedMemory = container.memoryUsage();
+
+    container.freeze();
+    CHECK(container.isFrozen());
+    CHECK(container.storageLayout() == MagicalContainer::StorageLayout::Frozen);
+    CHECK(container.memoryUsage() < thawedMemory);
+    CHECK(container.getElements() == expected);
+    CHECK(container.size() == expected.size());
+    for (size_t k = 0; k < expected.size(); k += 7)
+    {
+        CHECK(container[k] == expected[k]);
+    }
+    CHECK(container.rank(0) == static_cast<size_t>(lower_bound(expected.begin(), expected.end(), 0) - expected.begin()));
+    CHECK(container.count(expected[10]) == static_cast<size_t>(std::count(expected.begin(), expected.end(), expected[10])));
+    CHECK(container.successor(expected[0]) == *upper_bound(expected.begin(), expected.end(), expected[0]));
+    CHECK_FALSE(container.contains(15001));
+
+    vector<int> primes;
+    for (int value : expected)
+    {
+        if (container.isPrime(value))
+        {
+            primes.push_back(value);
+        }
+    }
+    vector<int> iteratedPrimes;
+    MagicalContainer::PrimeIterator primeIt(container);
+    for (auto it = primeIt.begin(); it != primeIt.end(); ++it)
+    {
+        iteratedPrimes.push_back(*it);
+    }
+    CHECK(iteratedPrimes == primes);
+    CHECK(container.primeRank(1000) == static_cast<size_t>(lower_bound(primes.begin(), primes.end(), 1000) - primes.begin()));
+
+    CHECK_THROWS_AS(container.addElement(1), logic_error);
+    CHECK_THROWS_AS(container.tryRemoveElement(expected[0]), logic_error);
+    CHECK_THROWS_AS(container.removeRange(0, 100), logic_error);
+    CHECK(container.getElements() == expected);
+
+    container.thaw();
+    CHECK_FALSE(container.isFrozen());
+    CHECK(container.storageLayout() == MagicalContainer::StorageLayout::RunLength);
+    CHECK(container.tryRemoveElement(expected[0]));
+    container.addElement(expected[0]);
+    CHECK(container.getElements() == expected);
+}
+
+// Test case for the block-packed layout: bit-packed blocks answer every query and shrink clustered values
+TEST_CASE("Block-packed storage layout") {
+    MagicalContainer container;
+    vector<int> expected;
+    for (int i = 0; i < 20000; ++i)
+    {
+        expected.push_back(i * 8 + i % 7 - 80000);
+    }
+    for (int value : expected)
+    {
+        container.addElement(value);
+    }
+    size_t vectorMemory = container.memoryUsage();
+    container.setStorageLayout(MagicalContainer::StorageLayout::BlockPacked);
+    CHECK(container.storageLayout() == MagicalContainer::StorageLayout::BlockPacked);
+    CHECK(container.memoryUsage() * 2 < vectorMemory);
+
+    // A scan decodes block after block
+    vector<int> iterated;
+    MagicalContainer::AscendingIterator it(container);
+    for (auto current = it.begin(); current != it.end(); ++current)
+    {
+        iterated.push_back(*current);
+    }
+    CHECK(iterated == expected);
+    CHECK(container[12345] == expected[12345]);
+    CHECK(container.rank(0) == static_cast<size_t>(lower_bound(expected.begin(), expected.end(), 0) - expected.begin()));
+
+    // Writes split and fold blocks
+    for (int i = 0; i < 2000; ++i)
+    {
+        int value = i * 17 - 40000;
+        container.addElement(value);
+        expected.insert(upper_bound(expected.begin(), expected.end(), value), value);
+    }
+    CHECK(container.removeRange(-10000, 10000) == static_cast<size_t>(
+              upper_bound(expected.begin(), expected.end(), 10000) - lower_bound(expected.begin(), expected.end(), -10000)));
+    expected.erase(lower_bound(expected.begin(), expected.end(), -10000), upper_bound(expected.begin(), expected.end(), 10000));
+    CHECK(container.tryRemoveElement(expected.front()));
+    expected.erase(expected.begin());
+    CHECK_FALSE(container.tryRemoveElement(0));
+    CHECK(container.getElements() == expected);
+
+    vector<int> primes;
+    for (int value : expected)
+    {
+        if (container.isPrime(value))
+        {
+            primes.push_back(value);
+        }
+    }
+    vector<int> iteratedPrimes;
+    MagicalContainer::PrimeIterator primeIt(container);
+    for (auto current = primeIt.begin(); current != primeIt.end(); ++current)
+    {
+        iteratedPrimes.push_back(*current);
+    }
+    CHECK(iteratedPrimes == primes);
+}
+
+// Test case for the payload columns: payloads follow their elements through every insertion and removal
+TEST_CASE("Satellite payload columns") {
+    MagicalContainer container;
+    container.addElement(4);
+    CHECK_THROWS_AS(container.addElement(5, 500), logic_error);
+    CHECK_THROWS_AS(container.recordIdAt(0), logic_error);
+    container.enablePayloads(true);
+    CHECK(container.hasPayloads());
+    CHECK(container.recordIdAt(0) == 0);
+    container.setPayloadAt(0, 4000, 0);
+    CHECK_THROWS_AS(container.setTombstoneMode(true), logic_error);
+    CHECK_THROWS_AS(container.setStorageLayout(MagicalContainer::StorageLayout::Roaring), logic_error);
+    CHECK_THROWS_AS(container.freeze(), logic_error);
+
+    // The record ID of value v is 1000 * v and its flags word is v % 4, whatever the insertion order
+    for (int i = 0; i < 300; ++i)
+    {
+        int value = (i * 37) % 300;
+        container.addElement(value, static_cast<uint64_t>(value) * 1000, static_cast<uint32_t>(value % 4));
+    }
+    container.removeElement(4);
+    CHECK(container.removeRange(100, 149) == 50);
+    CHECK(container.removeIf([](int value) { return value % 10 == 9; }) == 25);
+    vector<int> victims{0, 1, 2, 3};
+    CHECK(container.removeElements(victims) == 0);
+    CHECK_THROWS_AS(container.recordIdAt(container.size()), out_of_range);
+
+    MagicalContainer::AscendingIterator ascending(container);
+    size_t matching = 0;
+    for (auto it = ascending.begin(); it != ascending.end(); ++it)
+    {
+        matching += (it.recordId() == static_cast<uint64_t>(*it) * 1000 && it.flags() == static_cast<uint32_t>(*it % 4)) ? 1U : 0U;
+    }
+    CHECK(matching == container.size());
+
+    MagicalContainer::PrimeIterator primes(container);
+    matching = 0;
+    size_t primeCount = 0;
+    for (auto it = primes.begin(); it != primes.end(); ++it, ++primeCount)
+    {
+        matching += (it.recordId() == static_cast<uint64_t>(*it) * 1000) ? 1U : 0U;
+    }
+    CHECK(primeCount > 0);
+    CHECK(matching == primeCount);
+
+    MagicalContainer::SideCrossIterator cross(container);
+    auto it = cross.begin();
+    ++it;
+    CHECK(*it == 298);
+    CHECK(it.recordId() == 298000);
+    CHECK(it.flags() == 2);
+
+    container.enablePayloads(false);
+    CHECK_THROWS_AS(container.flagsAt(0), logic_error);
+    container.setStorageLayout(MagicalContainer::StorageLayout::Roaring);
+    CHECK(container.size() == 221);
+}
+
+// Test case for the secondary indexes: each derived order stays in step with insertions and removals
+TEST_CASE("Secondary-key indexes") {
+    MagicalContainer container;
+    for (int i = 0; i < 200; ++i)
+    {
+        container.addElement((i * 53) % 400 - 100);
+    }
+    size_t byDigits = container.addSecondaryIndex(SecondaryIndex::digitSum());
+    size_t byRemainder = container.addSecondaryIndex(SecondaryIndex::modulo(7));
+    size_t byDistance = container.addSecondaryIndex([](int value) { return value > 50 ? value - 50LL : 50LL - value; });
+    CHECK(container.secondaryIndexCount() == 3);
+    CHECK_THROWS_AS(SecondaryIndex::modulo(0), invalid_argument);
+    CHECK_THROWS_AS(MagicalContainer::KeyOrderIterator(container, 3), invalid_argument);
+
+    container.addElement(7);
+    container.addElement(7);
+    container.removeElement(-100);
+    container.removeRange(200, 250);
+    container.removeIf([](int value) { return value % 11 == 0; });
+    vector<int> victims{7, 12};
+    container.removeElements(victims);
+    container.setStorageLayout(MagicalContainer::StorageLayout::RunLength);
+    container.addElement(-99);
+    CHECK(container.tryRemoveElement(-99));
+
+    // Every order holds the elements sorted by (key, value)
+    auto checkOrder = [&container](size_t indexId, const function<long long(int)> &key)
+    {
+        vector<pair<long long, int>> expected;
+        for (int value : container.getElements())
+        {
+            expected.emplace_back(key(value), value);
+        }
+        sort(expected.begin(), expected.end());
+        vector<pair<long long, int>> iterated;
+        MagicalContainer::KeyOrderIterator order(container, indexId);
+        for (auto it = order.begin(); it != order.end(); ++it)
+        {
+            iterated.emplace_back(it.key(), *it);
+        }
+        CHECK(iterated == expected);
+    };
+    checkOrder(byDigits, SecondaryIndex::digitSum());
+    checkOrder(byRemainder, [](int value) { return ((value % 7) + 7) % 7; });
+    checkOrder(byDistance, [](int value) { return value > 50 ? value - 50LL : 50LL - value; });
+
+    MagicalContainer::KeyOrderIterator order(container, byRemainder);
+    CHECK(order.key() == 0);
+    CHECK(*order % 7 == 0);
+    container.clearSecondaryIndexes();
+    CHECK(container.secondaryIndexCount() == 0);
+}
+
+// Test case for the smallest-prime-factor cache: factorizations and smooth traversal agree with trial division
+TEST_CASE("Prime factors and smooth traversal") {
+    MagicalContainer container;
+    vector<int> values{0, 1, -1, 2, 12, -360, 97, 1024, 65537, 999983, 2147483647, INT_MIN, 2 * 3 * 5 * 7 * 11 * 13 * 17 * 19};
+    for (int i = 2; i < 500; ++i)
+    {
+        values.push_back(i * 31);
+    }
+    for (int value : values)
+    {
+        container.addElement(value);
+    }
+    CHECK(container.factorCacheMemory() == 0);
+
+    auto trialFactors = [](int value)
+    {
+        vector<int> factors;
+        long long rest = value < 0 ? -static_cast<long long>(value) : value;
+        for (long long divisor = 2; rest > 1 && divisor * divisor <= rest; ++divisor)
+        {
+            for (; rest % divisor == 0; rest /= divisor)
+            {
+                factors.push_back(static_cast<int>(divisor));
+            }
+        }
+        if (rest > 1)
+        {
+            factors.push_back(static_cast<int>(rest));
+        }
+        return factors;
+    };
+
+    size_t matching = 0;
+    for (size_t i = 0; i < container.size(); ++i)
+    {
+        vector<int> iterated;
+        MagicalContainer::FactorIterator factors(container, i);
+        for (auto it = factors.begin(); it != factors.end(); ++it)
+        {
+            iterated.push_back(*it);
+        }
+        vector<int> expected = trialFactors(container[i]);
+        matching += (iterated == expected && container.primeFactors(container[i]) == expected) ? 1U : 0U;
+    }
+    CHECK(matching == container.size());
+    CHECK(container.factorCacheMemory() > 0);
+    CHECK(container.primeFactors(INT_MIN) == vector<int>(31, 2));
+    CHECK(container.primeFactors(-360) == vector<int>{2, 2, 2, 3, 3, 5});
+    CHECK_THROWS_AS(MagicalContainer::FactorIterator(container, container.size()), out_of_range);
+
+    // Elements whose largest prime factor is at most 7
+    vector<int> expected;
+    for (int value : container.getElements())
+    {
+        vector<int> factors = trialFactors(value);
+        if (value != 0 && (factors.empty() || factors.back() <= 7))
+        {
+            expected.push_back(value);
+        }
+    }
+    vector<int> smooth;
+    MagicalContainer::SmoothIterator traversal(container, 7);
+    for (auto it = traversal.begin(); it != traversal.end(); ++it)
+    {
+        smooth.push_back(*it);
+    }
+    CHECK(smooth == expected);
+    CHECK(container.isSmooth(1, 1));
+    CHECK_FALSE(container.isSmooth(0, 100));
+}
+
+// Test case for the batch primality kernel: sieve, prefilter and Miller-Rabin agree with trial division
+TEST_CASE("Batch primality classification") {
+    auto trialPrime = [](int value)
+    {
+        if (value < 2)
+        {
+            return false;
+        }
+        for (int divisor = 2; divisor <= value / divisor; ++divisor)
+        {
+            if (value % divisor == 0)
+            {
+                return false;
+            }
+        }
+        return true;
+    };
+    // Both sides of the sieve limit, strong pseudoprimes to small bases, Carmichael numbers and the int extremes
+    vector<int> values{INT_MIN, -7, -2, -1, 0, 1, 2, 3, 4, 2047, 561, 1105, 1373653, 25326001, 3215031, 1000000007,
+                       2147483647, 2147483646, 2147483629, 46337 * 46327};
+    for (int i = (1 << 20) - 300; i < (1 << 20) + 300; ++i)
+    {
+        values.push_back(i);
+    }
+    for (int i = 0; i < 2000; ++i)
+    {
+        values.push_back(static_cast<int>((static_cast<long long>(i) * 2654435761LL) % INT_MAX));
+    }
+
+    vector<uint64_t> mask((values.size() + 63) / 64, ~0ULL);
+    classifyPrimes(values, mask);
+    size_t matching = 0;
+    for (size_t i = 0; i < values.size(); ++i)
+    {
+        bool expected = trialPrime(values[i]);
+        matching += (((mask[i / 64] >> (i % 64)) & 1) == (expected ? 1U : 0U) && isPrimeValue(values[i]) == expected) ? 1U : 0U;
+    }
+    CHECK(matching == values.size());
+    CHECK((mask.back() >> (values.size() % 64)) == 0);
+    vector<uint64_t> tooSmall(mask.size() - 1);
+    CHECK_THROWS_AS(classifyPrimes(values, tooSmall), invalid_argument);
+
+    // The prime iterator sees the same classification through the rebuilt prime indices
+    MagicalContainer container;
+    for (int value : values)
+    {
+        container.addElement(value);
+    }
+    size_t primes = 0;
+    MagicalContainer::PrimeIterator primeIt(container);
+    for (auto it = primeIt.begin(); it != primeIt.end(); ++it)
+    {
+        primes += trialPrime(*it) ? 1U : 0U;
+    }
+    CHECK(primes == static_cast<size_t>(count_if(values.begin(), values.end(), trialPrime)));
+    CHECK(container.isPrime(2147483647));
+}
+
+// Test case for the segmented sieve: dense sorted windows agree with the per-element classification
+TEST_CASE("Segmented sieve classification") {
+    // Small values ahead of a dense window past the sieve bitmap, a dense window ending at INT_MAX, and a sparse one
+    vector<int> sorted{-3, 0, 2, 17, 1000};
+    for (int i = 0; i < 3000; ++i)
+    {
+        sorted.push_back((1 << 20) + 200001 + i * 2);
+    }
+    vector<int> top;
+    for (int i = 0; i < 3000; ++i)
+    {
+        top.push_back(INT_MAX - 30000 + i * 10);
+    }
+    top.push_back(INT_MAX);
+    vector<int> sparse(sorted.begin(), sorted.begin() + 5);
+    for (int i = 0; i < 200; ++i)
+    {
+        sparse.push_back((1 << 20) + i * 9999991);
+    }
+
+    for (const vector<int> &values : {sorted, top, sparse})
+    {
+        vector<uint64_t> expected((values.size() + 63) / 64);
+        vector<uint64_t> actual(expected.size(), ~0ULL);
+        classifyPrimes(values, expected);
+        classifySortedPrimes(values, actual);
+        CHECK(actual == expected);
+    }
+
+    // A full rebuild of the prime index goes through the same path
+    MagicalContainer container;
+    container.setInsertBuffer(true, 8192);
+    for (int value : sorted)
+    {
+        container.addElement(value);
+    }
+    size_t primes = 0;
+    MagicalContainer::PrimeIterator primeIt(container);
+    for (auto it = primeIt.begin(); it != primeIt.end(); ++it)
+    {
+        primes += isPrimeValue(*it) ? 1U : 0U;
+    }
+    CHECK(primes == static_cast<size_t>(count_if(sorted.begin(), sorted.end(), isPrimeValue)));
+    CHECK(primes > 100);
+}
+
+// Test case for the shared, memoizing primality oracle
+TEST_CASE("Shared primality oracle") {
+    PrimalityOracle oracle(64, 1U << 16);
+    CHECK(oracle.stats().sieveLimit == 0);
+    CHECK_FALSE(oracle.isPrime(-7));
+    CHECK_FALSE(oracle.isPrime(1));
+    CHECK(oracle.isPrime(2));
+
+    // Small values come off the bitmap, which grows lazily up to its cap
+    for (int value = 0; value < 70000; ++value)
+    {
+        CHECK(oracle.isPrime(value) == isPrimeValue(value));
+    }
+    PrimalityOracle::Stats stats = oracle.stats();
+    CHECK(stats.sieveLimit == (1U << 16));
+    CHECK(stats.sieveAnswers > 60000);
+    CHECK(stats.misses > 0);
+
+    // Repeated large values are answered by the memo
+    oracle.resetStats();
+    vector<int> large;
+    for (int i = 0; i < 40; ++i)
+    {
+        large.push_back(2147483647 - i * 2);
+    }
+    for (int round = 0; round < 5; ++round)
+    {
+        for (int value : large)
+        {
+            CHECK(oracle.isPrime(value) == isPrimeValue(value));
+        }
+    }
+    stats = oracle.stats();
+    CHECK(stats.sieveAnswers == 0);
+    CHECK(stats.hits > stats.misses);
+    CHECK(stats.hitRate() > 0.5);
+
+    // Overflowing the memo evicts, never growing past the capacity
+    for (int i = 0; i < 2000; ++i)
+    {
+        oracle.isPrime(1000000007 + i * 2);
+    }
+    stats = oracle.stats();
+    CHECK(stats.evictions > 0);
+    CHECK(stats.entries <= stats.capacity);
+    CHECK(stats.capacity == 128);
+
+    // Concurrent queries agree with the kernel
+    vector<int> wrong(4, 0);
+    vector<thread> threads;
+    for (size_t t = 0; t < 4; ++t)
+    {
+        threads.emplace_back([&oracle, &wrong, t]() {
+            for (int i = 0; i < 3000; ++i)
+            {
+                int value = 1900000001 + (i * 7 + static_cast<int>(t) * 3) % 5000;
+                wrong[t] += oracle.isPrime(value) != isPrimeValue(value) ? 1 : 0;
+            }
+        });
+    }
+    for (thread &worker : threads)
+    {
+        worker.join();
+    }
+    CHECK(wrong == vector<int>(4, 0));
+
+    // The capacity is fixed at construction, rounded up per shard
+    PrimalityOracle larger(1 << 12);
+    stats = larger.stats();
+    CHECK(stats.capacity == (1 << 12));
+    CHECK(stats.entries == 0);
+    CHECK(PrimalityOracle(100).stats().capacity == 16 * 8);
+
+    // Containers consult the process-wide oracle
+    PrimalityOracle::shared().resetStats();
+    MagicalContainer container;
+    CHECK(container.isPrime(2147483629));
+    CHECK_FALSE(container.isPrime(2147483627));
+    stats = PrimalityOracle::shared().stats();
+    CHECK(stats.hits + stats.misses >= 2);
+}
+
+// Test case for an insert the layout rejects: no side structure may record the value
+TEST_CASE("Rejected insert leaves the container consistent") {
+    MagicalContainer container;
+    container.setUniqueMode(true, true);
+    container.enableMembershipFilter(true);
+    for (int i = 0; i < 100; ++i)
+    {
+        container.addElement(i * 3);
+    }
+    size_t byDigits = container.addSecondaryIndex(SecondaryIndex::digitSum());
+    container.setStorageLayout(MagicalContainer::StorageLayout::Dense);
+    CHECK_THROWS_AS(container.addElement(INT_MAX), out_of_range);
+    CHECK(container.size() == 100);
+    CHECK_FALSE(container.contains(INT_MAX));
+
+    size_t indexed = 0;
+    MagicalContainer::KeyOrderIterator order(container, byDigits);
+    for (auto it = order.begin(); it != order.end(); ++it)
+    {
+        CHECK(*it != INT_MAX);
+        ++indexed;
+    }
+    CHECK(indexed == 100);
+
+    // The unique filter did not keep the value either
+    container.setStorageLayout(MagicalContainer::StorageLayout::SortedVector);
+    CHECK(container.addElement(INT_MAX));
+    CHECK_FALSE(container.addElement(INT_MAX));
+    CHECK(container.size() == 101);
+}
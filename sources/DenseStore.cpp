@@ -0,0 +1,369 @@
+#include "DenseStore.hpp"
+#include <algorithm>
+#include <bit>
+#include <climits>
+#include <stdexcept>
+using namespace ariel;
+using namespace std;
+
+namespace
+{
+    const long long maxDomainWidth = 1LL << 30;// Widest domain accepted, 128 MiB per bitmap
+
+    // Returns the position of the r-th set bit (0-based) of word
+    unsigned selectBit(uint64_t word, size_t r)
+    {
+        for (size_t i = 0; i < r; ++i)
+        {
+            word &= word - 1;
+        }
+        return static_cast<unsigned>(countr_zero(word));
+    }
+}
+
+// Constructor for DenseStore over the values in [low, high]
+DenseStore::DenseStore(int low, int high) : low(low), high(high), total(0), primeTotal(0)
+{
+    long long width = static_cast<long long>(high) - low + 1;
+    if (width <= 0 || width > maxDomainWidth)
+    {
+        throw std::invalid_argument("The dense domain must hold between 1 and 2^30 values.");
+    }
+    size_t words = static_cast<size_t>((width + 63) / 64);
+    bits.assign(words, 0);
+    multiBits.assign(words, 0);
+    wordTotals.reset(words);
+    primeWordTotals.reset(words);
+    sievePrimes();
+}
+
+// Returns a deep copy of the store
+unique_ptr<StorageBackend> DenseStore::clone() const
+{
+    return make_unique<DenseStore>(*this);
+}
+
+// Sieves the domain with the primes up to sqrt(high), one pass per small prime
+void DenseStore::sievePrimes()
+{
+    primeMask.assign(bits.size(), 0);
+    long long first = max<long long>(low, 2);
+    if (first > high)
+    {
+        return;
+    }
+    for (long long value = first; value <= high; ++value)
+    {
+        size_t offset = static_cast<size_t>(value - low);
+        primeMask[offset / 64] |= uint64_t{1} << (offset % 64);
+    }
+
+    long long limit = 1;
+    while ((limit + 1) * (limit + 1) <= high)
+    {
+        ++limit;
+    }
+    vector<bool> composite(static_cast<size_t>(limit) + 1, false);
+    for (long long p = 2; p <= limit; ++p)
+    {
+        if (composite[static_cast<size_t>(p)])
+        {
+            continue;
+        }
+        for (long long multiple = p * p; multiple <= limit; multiple += p)
+        {
+            composite[static_cast<size_t>(multiple)] = true;
+        }
+        // Clear the multiples of p within the domain, starting at p * p
+        long long start = max(p * p, (first + p - 1) / p * p);
+        for (long long multiple = start; multiple <= high; multiple += p)
+        {
+            size_t offset = static_cast<size_t>(multiple - low);
+            primeMask[offset / 64] &= ~(uint64_t{1} << (offset % 64));
+        }
+    }
+}
+
+// Counts the set bits of the selected values, plus the extra copies of the duplicated ones
+size_t DenseStore::copiesInWord(size_t word, uint64_t selected) const
+{
+    size_t copies = static_cast<size_t>(popcount(bits[word] & selected));
+    for (uint64_t multi = multiBits[word] & selected; multi != 0; multi &= multi - 1)
+    {
+        size_t offset = word * 64 + static_cast<size_t>(countr_zero(multi));
+        copies += extraCopies.at(low + static_cast<int>(offset));
+    }
+    return copies;
+}
+
+// Finds the word through the Fenwick tree, then the bit inside it
+int DenseStore::selectMasked(size_t k, const FenwickTree &totals, const vector<uint64_t> *mask) const
+{
+    size_t word = totals.searchPrefix(static_cast<long long>(k) + 1) - 1;
+    size_t r = k - static_cast<size_t>(totals.prefixSum(word));
+    uint64_t candidates = bits[word] & (mask ? (*mask)[word] : ~uint64_t{0});
+    if ((multiBits[word] & candidates) == 0)
+    {
+        return low + static_cast<int>(word * 64 + selectBit(candidates, r));
+    }
+    // Duplicated values take several positions each
+    for (; candidates != 0; candidates &= candidates - 1)
+    {
+        unsigned bit = static_cast<unsigned>(countr_zero(candidates));
+        int value = low + static_cast<int>(word * 64 + bit);
+        size_t copies = 1 + (((multiBits[word] >> bit) & 1) ? extraCopies.at(value) : 0);
+        if (r < copies)
+        {
+            return value;
+        }
+        r -= copies;
+    }
+    throw std::out_of_range("Position out of range.");
+}
+
+// Sums the full words before the value's word, then the lower bits of its own word
+size_t DenseStore::rankMasked(int value, const FenwickTree &totals, const vector<uint64_t> *mask, size_t count) const
+{
+    if (value <= low)
+    {
+        return 0;
+    }
+    if (value > high)
+    {
+        return count;
+    }
+    size_t offset = static_cast<size_t>(static_cast<long long>(value) - low);
+    size_t word = offset / 64;
+    uint64_t below = (uint64_t{1} << (offset % 64)) - 1;
+    if (mask)
+    {
+        below &= (*mask)[word];
+    }
+    return static_cast<size_t>(totals.prefixSum(word)) + copiesInWord(word, below);
+}
+
+// Adds delta copies of the value at offset to the word totals
+void DenseStore::countCopy(size_t offset, long long delta)
+{
+    size_t word = offset / 64;
+    wordTotals.add(word, delta);
+    total = static_cast<size_t>(static_cast<long long>(total) + delta);
+    if ((primeMask[word] >> (offset % 64)) & 1)
+    {
+        primeWordTotals.add(word, delta);
+        primeTotal = static_cast<size_t>(static_cast<long long>(primeTotal) + delta);
+    }
+}
+
+// Replaces the contents with the given sorted values; throws out_of_range if one is outside the domain
+void DenseStore::assign(const vector<int> &sorted)
+{
+    if (!sorted.empty() && (!covers(sorted.front()) || !covers(sorted.back())))
+    {
+        throw std::out_of_range("The value lies outside the dense domain.");
+    }
+    fill(bits.begin(), bits.end(), 0);
+    fill(multiBits.begin(), multiBits.end(), 0);
+    extraCopies.clear();
+    vector<long long> totals(bits.size(), 0);
+    vector<long long> primeTotals(bits.size(), 0);
+    primeTotal = 0;
+    for (size_t i = 0; i < sorted.size(); ++i)
+    {
+        size_t offset = static_cast<size_t>(static_cast<long long>(sorted[i]) - low);
+        uint64_t bit = uint64_t{1} << (offset % 64);
+        if (i > 0 && sorted[i] == sorted[i - 1])
+        {
+            multiBits[offset / 64] |= bit;
+            ++extraCopies[sorted[i]];
+        }
+        bits[offset / 64] |= bit;
+        ++totals[offset / 64];
+        if (primeMask[offset / 64] & bit)
+        {
+            ++primeTotals[offset / 64];
+            ++primeTotal;
+        }
+    }
+    wordTotals.assign(totals);
+    primeWordTotals.assign(primeTotals);
+    total = sorted.size();
+}
+
+// Extends the range on the side of value, to at least twice its width
+void DenseStore::widenedRange(int value, long long &newLow, long long &newHigh) const
+{
+    long long width = static_cast<long long>(high) - low + 1;
+    newLow = low;
+    newHigh = high;
+    if (value < low)
+    {
+        newLow = max<long long>(INT_MIN, min<long long>(value, high - 2 * width + 1));
+    }
+    else
+    {
+        newHigh = min<long long>(INT_MAX, max<long long>(value, low + 2 * width - 1));
+    }
+}
+
+// Rebuilds the store over a range at least twice as wide, extended on the side of value
+void DenseStore::widen(int value)
+{
+    long long newLow = 0;
+    long long newHigh = 0;
+    widenedRange(value, newLow, newHigh);
+    if (newHigh - newLow + 1 > maxDomainWidth)
+    {
+        throw std::out_of_range("The value lies too far outside the dense domain.");
+    }
+    vector<int> values;
+    values.reserve(total);
+    appendTo(values);
+    DenseStore wider(static_cast<int>(newLow), static_cast<int>(newHigh));
+    wider.assign(values);
+    *this = std::move(wider);
+}
+
+// Accepts the values of the domain, and those a widening reaches
+bool DenseStore::accepts(int value) const
+{
+    if (covers(value))
+    {
+        return true;
+    }
+    long long newLow = 0;
+    long long newHigh = 0;
+    widenedRange(value, newLow, newHigh);
+    return newHigh - newLow + 1 <= maxDomainWidth;
+}
+
+// Inserts one copy of value, widening the domain first if needed
+void DenseStore::insert(int value)
+{
+    if (!covers(value))
+    {
+        widen(value);
+    }
+    size_t offset = static_cast<size_t>(static_cast<long long>(value) - low);
+    uint64_t bit = uint64_t{1} << (offset % 64);
+    if (bits[offset / 64] & bit)
+    {
+        multiBits[offset / 64] |= bit;
+        ++extraCopies[value];
+    }
+    bits[offset / 64] |= bit;
+    countCopy(offset, 1);
+}
+
+// Removes one copy of value
+bool DenseStore::erase(int value)
+{
+    if (!covers(value))
+    {
+        return false;
+    }
+    size_t offset = static_cast<size_t>(static_cast<long long>(value) - low);
+    uint64_t bit = uint64_t{1} << (offset % 64);
+    if (!(bits[offset / 64] & bit))
+    {
+        return false;
+    }
+    if (multiBits[offset / 64] & bit)
+    {
+        auto extra = extraCopies.find(value);
+        if (--extra->second == 0)
+        {
+            extraCopies.erase(extra);
+            multiBits[offset / 64] &= ~bit;
+        }
+    }
+    else
+    {
+        bits[offset / 64] &= ~bit;
+    }
+    countCopy(offset, -1);
+    return true;
+}
+
+// Returns the number of stored values
+size_t DenseStore::size() const
+{
+    return total;
+}
+
+// Returns the k-th smallest value
+int DenseStore::select(size_t k) const
+{
+    return selectMasked(k, wordTotals, nullptr);
+}
+
+// Returns the number of stored values smaller than value
+size_t DenseStore::rank(int value) const
+{
+    return rankMasked(value, wordTotals, nullptr, total);
+}
+
+// Appends every stored value in ascending order by scanning the set bits
+void DenseStore::appendTo(vector<int> &out) const
+{
+    for (size_t word = 0; word < bits.size(); ++word)
+    {
+        for (uint64_t present = bits[word]; present != 0; present &= present - 1)
+        {
+            unsigned bit = static_cast<unsigned>(countr_zero(present));
+            int value = low + static_cast<int>(word * 64 + bit);
+            size_t copies = 1 + (((multiBits[word] >> bit) & 1) ? extraCopies.at(value) : 0);
+            out.insert(out.end(), copies, value);
+        }
+    }
+}
+
+// Returns the approximate number of bytes the bitmaps, the totals and the extra copies occupy
+size_t DenseStore::memoryUsage() const
+{
+    return (bits.capacity() + multiBits.capacity() + primeMask.capacity()) * sizeof(uint64_t) +
+           (wordTotals.size() + primeWordTotals.size() + 2) * sizeof(long long) +
+           extraCopies.size() * (sizeof(pair<const int, size_t>) + sizeof(void *));
+}
+
+// The prime queries run over the presence bits ANDed with the prime mask
+bool DenseStore::tracksPrimes() const
+{
+    return true;
+}
+
+// Returns the number of stored primes
+size_t DenseStore::primeSize() const
+{
+    return primeTotal;
+}
+
+// Returns the k-th smallest stored prime
+int DenseStore::primeSelect(size_t k) const
+{
+    return selectMasked(k, primeWordTotals, &primeMask);
+}
+
+// Returns the number of stored primes smaller than value
+size_t DenseStore::primeRank(int value) const
+{
+    return rankMasked(value, primeWordTotals, &primeMask, primeTotal);
+}
+
+// Returns true if value lies within the domain
+bool DenseStore::covers(int value) const
+{
+    return value >= low && value <= high;
+}
+
+// Returns the smallest storable value
+int DenseStore::domainLow() const
+{
+    return low;
+}
+
+// Returns the largest storable value
+int DenseStore::domainHigh() const
+{
+    return high;
+}
@@ -0,0 +1,84 @@
+#ifndef DENSESTORE_HPP
+#define DENSESTORE_HPP
+
+#include <cstdint>
+#include <unordered_map>
+#include "FenwickTree.hpp"
+#include "StorageBackend.hpp"
+
+namespace ariel
+{
+    // Dense-domain storage for values drawn from a narrow range [low, high]: one presence bit
+    // per value of the range, with the rare extra copies of duplicated values kept aside.
+    // A Fenwick tree over the per-word totals turns rank and select into one O(log(w)) walk
+    // plus a popcount inside a single 64-bit word, where w is the number of words.
+    // The primes of the range are sieved once into a mask, so the prime queries are the same
+    // walks over the presence bits ANDed with the mask and no second store is needed.
+    // Inserting a value outside the range at least doubles the range towards it.
+    class DenseStore : public StorageBackend
+    {
+    private:
+        int low;// Smallest storable value
+        int high;// Largest storable value
+        vector<uint64_t> bits;// Bit i is set if low + i is stored
+        vector<uint64_t> multiBits;// Bit i is set if low + i is stored more than once
+        vector<uint64_t> primeMask;// Bit i is set if low + i is prime
+        unordered_map<int, size_t> extraCopies;// Copies beyond the first of every duplicated value
+        FenwickTree wordTotals;// Stored values per word of bits
+        FenwickTree primeWordTotals;// Stored primes per word of bits
+        size_t total;// Number of stored values
+        size_t primeTotal;// Number of stored primes
+
+        // Marks the primes of the domain in primeMask with a sieve over [low, high].
+        void sievePrimes();
+
+        // Returns the number of stored copies of the values of word whose bits are in selected.
+        size_t copiesInWord(size_t word, uint64_t selected) const;
+
+        // Returns the k-th smallest stored value among the bits selected by mask (nullptr for all).
+        int selectMasked(size_t k, const FenwickTree &totals, const vector<uint64_t> *mask) const;
+
+        // Returns the number of stored values smaller than value among the bits selected by mask.
+        size_t rankMasked(int value, const FenwickTree &totals, const vector<uint64_t> *mask, size_t count) const;
+
+        // Adds delta copies of the value at offset to the word totals.
+        void countCopy(size_t offset, long long delta);
+
+        // Returns the range widen(value) would rebuild the store over.
+        void widenedRange(int value, long long &newLow, long long &newHigh) const;
+
+        // Rebuilds the store over a range at least twice as wide that covers value.
+        void widen(int value);
+
+    public:
+        // Creates an empty store for values in [low, high]; throws invalid_argument for an empty
+        // or over-wide range.
+        DenseStore(int low, int high);
+
+        unique_ptr<StorageBackend> clone() const override;
+        void assign(const vector<int> &sorted) override;
+        // Widens the domain first if needed; throws out_of_range if it would exceed 2^30 values.
+        void insert(int value) override;
+        bool erase(int value) override;
+        size_t size() const override;
+        int select(size_t k) const override;
+        size_t rank(int value) const override;
+        void appendTo(vector<int> &out) const override;
+        size_t memoryUsage() const override;
+        // Returns false for values a widening cannot reach within 2^30 values.
+        bool accepts(int value) const override;
+        bool tracksPrimes() const override;
+        size_t primeSize() const override;
+        int primeSelect(size_t k) const override;
+        size_t primeRank(int value) const override;
+
+        // Returns true if value lies within the domain.
+        bool covers(int value) const;
+
+        // Returns the smallest (respectively largest) storable value.
+        int domainLow() const;
+        int domainHigh() const;
+    };
+}
+
+#endif // DENSESTORE_HPP
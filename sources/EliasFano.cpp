@@ -0,0 +1,343 @@
+#include "EliasFano.hpp"
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+using namespace ariel;
+using namespace std;
+
+namespace
+{
+    const size_t blockBits = 512;// Bits per rank block, one cache line
+    const size_t wordsPerBlock = blockBits / 64;
+    const size_t hintSpacing = 512;// Ones (or zeros) between two select hints
+
+    // Returns the position of the r-th set bit (0-based) of word
+    unsigned selectBit(uint64_t word, size_t r)
+    {
+        for (size_t i = 0; i < r; ++i)
+        {
+            word &= word - 1;
+        }
+        return static_cast<unsigned>(countr_zero(word));
+    }
+}
+
+//*****SuccinctBits*****
+
+// Default constructor for SuccinctBits, creates an empty bitvector
+SuccinctBits::SuccinctBits() : bitCount(0), blockRanks(1, 0)
+{
+}
+
+// Counts the ones of every block and records the blocks where every 512th one and zero fall
+void SuccinctBits::build(vector<uint64_t> bits, size_t count)
+{
+    bitCount = count;
+    words = std::move(bits);
+    words.resize((count + blockBits - 1) / blockBits * wordsPerBlock, 0);
+    size_t blocks = words.size() / wordsPerBlock;
+    blockRanks.assign(blocks + 1, 0);
+    oneHints.clear();
+    zeroHints.clear();
+    size_t onesSoFar = 0;
+    for (size_t block = 0; block < blocks; ++block)
+    {
+        blockRanks[block] = onesSoFar;
+        size_t blockOnes = 0;
+        for (size_t w = 0; w < wordsPerBlock; ++w)
+        {
+            blockOnes += static_cast<size_t>(popcount(words[block * wordsPerBlock + w]));
+        }
+        size_t zerosSoFar = block * blockBits - onesSoFar;
+        size_t blockZeros = min(blockBits, bitCount - block * blockBits) - blockOnes;
+        while (oneHints.size() * hintSpacing < onesSoFar + blockOnes)
+        {
+            oneHints.push_back(block);
+        }
+        while (zeroHints.size() * hintSpacing < zerosSoFar + blockZeros)
+        {
+            zeroHints.push_back(block);
+        }
+        onesSoFar += blockOnes;
+    }
+    blockRanks[blocks] = onesSoFar;
+    oneHints.push_back(blocks);
+    zeroHints.push_back(blocks);
+}
+
+// Returns the bit at position i
+bool SuccinctBits::get(size_t i) const
+{
+    return (words[i / 64] >> (i % 64)) & 1;
+}
+
+// Returns the number of zeros before the given block
+size_t SuccinctBits::zerosBefore(size_t block) const
+{
+    return block * blockBits - blockRanks[block];
+}
+
+// Adds the popcounts of the words of the block before position to the block's count
+size_t SuccinctBits::rank1(size_t position) const
+{
+    size_t block = position / blockBits;
+    size_t rank = blockRanks[block];
+    for (size_t w = block * wordsPerBlock; w < position / 64; ++w)
+    {
+        rank += static_cast<size_t>(popcount(words[w]));
+    }
+    if (position % 64 != 0)
+    {
+        rank += static_cast<size_t>(popcount(words[position / 64] & ((uint64_t{1} << (position % 64)) - 1)));
+    }
+    return rank;
+}
+
+// Narrows the blocks to the two surrounding hints, searches them, then scans one block
+size_t SuccinctBits::select1(size_t k) const
+{
+    size_t first = oneHints[k / hintSpacing];
+    size_t last = oneHints[k / hintSpacing + 1];
+    // The last block in [first, last] with fewer than k + 1 ones before it
+    while (first < last)
+    {
+        size_t mid = (first + last + 1) / 2;
+        if (blockRanks[mid] <= k)
+        {
+            first = mid;
+        }
+        else
+        {
+            last = mid - 1;
+        }
+    }
+    size_t r = k - blockRanks[first];
+    for (size_t w = first * wordsPerBlock;; ++w)
+    {
+        size_t bits = static_cast<size_t>(popcount(words[w]));
+        if (r < bits)
+        {
+            return w * 64 + selectBit(words[w], r);
+        }
+        r -= bits;
+    }
+}
+
+// Same search over the zeros
+size_t SuccinctBits::select0(size_t k) const
+{
+    size_t first = zeroHints[k / hintSpacing];
+    size_t last = zeroHints[k / hintSpacing + 1];
+    while (first < last)
+    {
+        size_t mid = (first + last + 1) / 2;
+        if (zerosBefore(mid) <= k)
+        {
+            first = mid;
+        }
+        else
+        {
+            last = mid - 1;
+        }
+    }
+    size_t r = k - zerosBefore(first);
+    for (size_t w = first * wordsPerBlock;; ++w)
+    {
+        size_t bits = static_cast<size_t>(popcount(~words[w]));
+        if (r < bits)
+        {
+            return w * 64 + selectBit(~words[w], r);
+        }
+        r -= bits;
+    }
+}
+
+// Returns the number of ones
+size_t SuccinctBits::ones() const
+{
+    return blockRanks.back();
+}
+
+// Returns the number of bytes the bits and the directory occupy
+size_t SuccinctBits::memoryUsage() const
+{
+    return words.capacity() * sizeof(uint64_t) + blockRanks.capacity() * sizeof(uint64_t) +
+           (oneHints.capacity() + zeroHints.capacity()) * sizeof(size_t);
+}
+
+//*****EliasFano*****
+
+// Constructor for EliasFano, creates an empty encoding that marks primes with the given test
+EliasFano::EliasFano(Classifier isPrime) : isPrime(isPrime), base(0), count(0), universe(0), lowBits(0)
+{
+}
+
+// Returns a deep copy of the encoding
+unique_ptr<StorageBackend> EliasFano::clone() const
+{
+    return make_unique<EliasFano>(*this);
+}
+
+// Returns the low bits of the i-th value, which may straddle two words
+uint64_t EliasFano::lowAt(size_t i) const
+{
+    if (lowBits == 0)
+    {
+        return 0;
+    }
+    size_t bit = i * lowBits;
+    uint64_t value = lows[bit / 64] >> (bit % 64);
+    if (bit % 64 + lowBits > 64)
+    {
+        value |= lows[bit / 64 + 1] << (64 - bit % 64);
+    }
+    return value & ((uint64_t{1} << lowBits) - 1);
+}
+
+// Joins the high bits, read off the unary code, with the low bits
+uint64_t EliasFano::offsetAt(size_t i) const
+{
+    uint64_t high = highs.select1(i) - i;
+    return (high << lowBits) | lowAt(i);
+}
+
+// Encodes the sorted values and marks the primes among them
+void EliasFano::assign(const vector<int> &sorted)
+{
+    count = sorted.size();
+    base = sorted.empty() ? 0 : sorted.front();
+    universe = sorted.empty() ? 0 : static_cast<uint64_t>(static_cast<long long>(sorted.back()) - base) + 1;
+    lowBits = 0;
+    while (count > 0 && (universe >> (lowBits + 1)) >= count)
+    {
+        ++lowBits;
+    }
+
+    lows.assign((count * lowBits + 63) / 64 + 1, 0);
+    size_t highCount = count + static_cast<size_t>(universe >> lowBits) + 1;
+    vector<uint64_t> highBits((highCount + 63) / 64, 0);
+    vector<uint64_t> primeBits((count + 63) / 64, 0);
+    for (size_t i = 0; i < count; ++i)
+    {
+        uint64_t offset = static_cast<uint64_t>(static_cast<long long>(sorted[i]) - base);
+        if (lowBits > 0)
+        {
+            uint64_t low = offset & ((uint64_t{1} << lowBits) - 1);
+            size_t bit = i * lowBits;
+            lows[bit / 64] |= low << (bit % 64);
+            if (bit % 64 + lowBits > 64)
+            {
+                lows[bit / 64 + 1] |= low >> (64 - bit % 64);
+            }
+        }
+        size_t position = static_cast<size_t>(offset >> lowBits) + i;
+        highBits[position / 64] |= uint64_t{1} << (position % 64);
+        if (isPrime(sorted[i]))
+        {
+            primeBits[i / 64] |= uint64_t{1} << (i % 64);
+        }
+    }
+    highs.build(std::move(highBits), highCount);
+    primePositions.build(std::move(primeBits), count);
+}
+
+// The encoding is immutable
+void EliasFano::insert(int)
+{
+    throw std::logic_error("An Elias-Fano encoding cannot be modified.");
+}
+
+// The encoding is immutable
+bool EliasFano::erase(int)
+{
+    throw std::logic_error("An Elias-Fano encoding cannot be modified.");
+}
+
+// Returns the number of values
+size_t EliasFano::size() const
+{
+    return count;
+}
+
+// Decodes the k-th value
+int EliasFano::select(size_t k) const
+{
+    return static_cast<int>(base + static_cast<long long>(offsetAt(k)));
+}
+
+// Finds the bucket of values sharing the high bits of value, then binary searches its low bits
+size_t EliasFano::rank(int value) const
+{
+    if (count == 0 || value <= base)
+    {
+        return 0;
+    }
+    uint64_t offset = static_cast<uint64_t>(static_cast<long long>(value) - base);
+    if (offset >= universe)
+    {
+        return count;
+    }
+    size_t high = static_cast<size_t>(offset >> lowBits);
+    // The bucket of high starts after the high-th zero of the unary code and ends at the next one
+    size_t first = (high == 0) ? 0 : highs.select0(high - 1) + 1 - high;
+    size_t last = highs.select0(high) - high;
+    uint64_t low = offset & ((uint64_t{1} << lowBits) - 1);
+    while (first < last)
+    {
+        size_t mid = first + (last - first) / 2;
+        if (lowAt(mid) < low)
+        {
+            first = mid + 1;
+        }
+        else
+        {
+            last = mid;
+        }
+    }
+    return first;
+}
+
+// Decodes every value in order by walking the unary code once
+void EliasFano::appendTo(vector<int> &out) const
+{
+    size_t i = 0;
+    for (size_t position = 0; i < count; ++position)
+    {
+        if (highs.get(position))
+        {
+            uint64_t high = position - i;
+            out.push_back(static_cast<int>(base + static_cast<long long>((high << lowBits) | lowAt(i))));
+            ++i;
+        }
+    }
+}
+
+// Returns the number of bytes the low bits, the unary code and the prime marks occupy
+size_t EliasFano::memoryUsage() const
+{
+    return lows.capacity() * sizeof(uint64_t) + highs.memoryUsage() + primePositions.memoryUsage();
+}
+
+// The prime marks answer the prime queries
+bool EliasFano::tracksPrimes() const
+{
+    return true;
+}
+
+// Returns the number of primes
+size_t EliasFano::primeSize() const
+{
+    return primePositions.ones();
+}
+
+// Decodes the value at the position of the k-th prime mark
+int EliasFano::primeSelect(size_t k) const
+{
+    return select(primePositions.select1(k));
+}
+
+// Counts the prime marks before the rank of value
+size_t EliasFano::primeRank(int value) const
+{
+    return primePositions.rank1(rank(value));
+}
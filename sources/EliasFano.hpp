@@ -0,0 +1,94 @@
+#ifndef ELIASFANO_HPP
+#define ELIASFANO_HPP
+
+#include <cstdint>
+#include "StorageBackend.hpp"
+
+namespace ariel
+{
+    // Bitvector with a rank directory and select hints: one cumulative count per 512-bit block,
+    // and the block of every 512th one and zero, so rank is O(1) and select a short search.
+    class SuccinctBits
+    {
+    private:
+        vector<uint64_t> words;// The bits, least significant first
+        size_t bitCount;// Number of meaningful bits
+        vector<uint64_t> blockRanks;// Ones before every block, and the total at the end
+        vector<size_t> oneHints;// Block holding the (512 j)-th one
+        vector<size_t> zeroHints;// Block holding the (512 j)-th zero
+
+        // Returns the number of zeros before the given block.
+        size_t zerosBefore(size_t block) const;
+
+    public:
+        SuccinctBits();
+
+        // Takes the bits and builds the directory in O(bitCount / 64).
+        void build(vector<uint64_t> bits, size_t count);
+
+        // Returns the bit at position i.
+        bool get(size_t i) const;
+
+        // Returns the number of ones in [0, position).
+        size_t rank1(size_t position) const;
+
+        // Returns the position of the k-th one (respectively zero), 0-based.
+        size_t select1(size_t k) const;
+        size_t select0(size_t k) const;
+
+        // Returns the number of ones.
+        size_t ones() const;
+
+        // Returns the number of bytes the bits and the directory occupy.
+        size_t memoryUsage() const;
+    };
+
+    // Immutable Elias-Fano encoding of a sorted sequence of n values from a universe of size U:
+    // the low log(U/n) bits of every value are packed side by side, and the high bits are stored
+    // as gaps in unary, for about 2 + log(U/n) bits per value. select decodes one value with a
+    // select on the high bits; rank walks to the bucket of the high bits and searches it.
+    // A second bitvector marks the positions holding primes, for the prime queries.
+    class EliasFano : public StorageBackend
+    {
+    public:
+        using Classifier = bool (*)(int);// Primality test used to mark the prime positions
+
+    private:
+        Classifier isPrime;
+        int base;// Smallest value; the encoding stores the offsets from it
+        size_t count;// Number of values
+        uint64_t universe;// Largest offset plus one
+        unsigned lowBits;// Low bits stored explicitly per value
+        vector<uint64_t> lows;// Packed low bits
+        SuccinctBits highs;// Bit (offset >> lowBits) + i is set for the i-th value
+        SuccinctBits primePositions;// Bit i is set if the i-th value is prime
+
+        // Returns the low bits of the i-th value.
+        uint64_t lowAt(size_t i) const;
+
+        // Returns the offset of the i-th value from base.
+        uint64_t offsetAt(size_t i) const;
+
+    public:
+        explicit EliasFano(Classifier isPrime);
+
+        unique_ptr<StorageBackend> clone() const override;
+        void assign(const vector<int> &sorted) override;
+
+        // The encoding is immutable: insert and erase throw logic_error.
+        void insert(int value) override;
+        bool erase(int value) override;
+
+        size_t size() const override;
+        int select(size_t k) const override;
+        size_t rank(int value) const override;
+        void appendTo(vector<int> &out) const override;
+        size_t memoryUsage() const override;
+        bool tracksPrimes() const override;
+        size_t primeSize() const override;
+        int primeSelect(size_t k) const override;
+        size_t primeRank(int value) const override;
+    };
+}
+
+#endif // ELIASFANO_HPP
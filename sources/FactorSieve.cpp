@@ -0,0 +1,67 @@
+#include "FactorSieve.hpp"
+#include <algorithm>
+using namespace ariel;
+using namespace std;
+
+// Default constructor for FactorSieve, holds no table until build() is called
+FactorSieve::FactorSieve()
+{
+}
+
+// Linear sieve: every composite is crossed out exactly once, by its smallest prime factor
+void FactorSieve::build(uint32_t limit)
+{
+    limit = clamp(limit, minLimit, maxLimit);
+    smallestFactors.assign(static_cast<size_t>(limit) + 1, 0);
+    primes.clear();
+    for (uint32_t i = 2; i <= limit; ++i)
+    {
+        if (smallestFactors[i] == 0)
+        {
+            smallestFactors[i] = i;
+            primes.push_back(i);
+        }
+        for (uint32_t prime : primes)
+        {
+            uint64_t multiple = static_cast<uint64_t>(prime) * i;
+            if (prime > smallestFactors[i] || multiple > limit)
+            {
+                break;
+            }
+            smallestFactors[multiple] = prime;
+        }
+    }
+}
+
+// Returns the largest number in the table
+uint32_t FactorSieve::limit() const
+{
+    return smallestFactors.empty() ? 0 : static_cast<uint32_t>(smallestFactors.size() - 1);
+}
+
+// Looks n up in the table, or divides it by the sieved primes up to its square root
+uint32_t FactorSieve::smallestFactor(uint32_t n) const
+{
+    if (n < smallestFactors.size())
+    {
+        return smallestFactors[n];
+    }
+    for (uint32_t prime : primes)
+    {
+        if (prime > n / prime)
+        {
+            break;
+        }
+        if (n % prime == 0)
+        {
+            return prime;
+        }
+    }
+    return n;
+}
+
+// Returns the approximate number of bytes the table and the prime list occupy
+size_t FactorSieve::memoryUsage() const
+{
+    return (smallestFactors.capacity() + primes.capacity()) * sizeof(uint32_t);
+}
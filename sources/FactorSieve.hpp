@@ -0,0 +1,42 @@
+#ifndef FACTORSIEVE_HPP
+#define FACTORSIEVE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+namespace ariel
+{
+    // Smallest-prime-factor table over [0, limit], filled by a linear sieve in O(limit).
+    // A number within the table factors in O(number of factors) by repeated lookups; larger ones
+    // fall back to trial division by the sieved primes, which reach past the square root of INT_MAX.
+    class FactorSieve
+    {
+    public:
+        static constexpr uint32_t minLimit = 1U << 16;// Smallest table, covers every divisor up to sqrt(INT_MAX)
+        static constexpr uint32_t maxLimit = 1U << 22;// Largest table, 16 MiB
+
+    private:
+        vector<uint32_t> smallestFactors;// Smallest prime factor of every number up to limit, 0 below 2
+        vector<uint32_t> primes;// Primes up to limit, ascending
+
+    public:
+        FactorSieve();
+
+        // Rebuilds the table over [0, limit], clamped to [minLimit, maxLimit].
+        void build(uint32_t limit);
+
+        // Returns the largest number in the table, or 0 before the first build.
+        uint32_t limit() const;
+
+        // Returns the smallest prime factor of n, which must be at least 2; the table must be built.
+        uint32_t smallestFactor(uint32_t n) const;
+
+        // Returns the approximate number of bytes the table occupies.
+        size_t memoryUsage() const;
+    };
+}
+
+#endif // FACTORSIEVE_HPP
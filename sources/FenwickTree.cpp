@@ -0,0 +1,97 @@
+#include "FenwickTree.hpp"
+#include <algorithm>
+using namespace ariel;
+using namespace std;
+
+// Default constructor for FenwickTree, creates an empty tree
+FenwickTree::FenwickTree() : tree(1, 0)
+{
+}
+
+// Builds the tree bottom-up: every node pushes its partial sum to its parent once
+void FenwickTree::assign(const vector<long long> &values)
+{
+    tree.assign(values.size() + 1, 0);
+    for (size_t i = 1; i < tree.size(); ++i)
+    {
+        tree[i] += values[i - 1];
+        size_t parent = i + (i & (~i + 1));
+        if (parent < tree.size())
+        {
+            tree[parent] += tree[i];
+        }
+    }
+}
+
+// Resets the tree to hold count zeros
+void FenwickTree::reset(size_t count)
+{
+    tree.assign(count + 1, 0);
+}
+
+// The new node covers (i - lowbit(i), i], whose earlier entries are already summed in the tree
+void FenwickTree::push_back(long long value)
+{
+    size_t node = size() + 1;
+    tree.push_back(value + prefixSum(node - 1) - prefixSum(node - (node & (~node + 1))));
+}
+
+// Adds delta to a single entry and to every node covering it
+void FenwickTree::add(size_t position, long long delta)
+{
+    for (size_t i = position + 1; i < tree.size(); i += i & (~i + 1))
+    {
+        tree[i] += delta;
+    }
+}
+
+// Returns the sum of the first count entries
+long long FenwickTree::prefixSum(size_t count) const
+{
+    long long sum = 0;
+    for (size_t i = min(count, size()); i > 0; i -= i & (~i + 1))
+    {
+        sum += tree[i];
+    }
+    return sum;
+}
+
+// Returns the sum of the entries in [first, last)
+long long FenwickTree::rangeSum(size_t first, size_t last) const
+{
+    if (last <= first)
+    {
+        return 0;
+    }
+    return prefixSum(last) - prefixSum(first);
+}
+
+// Walks down the implicit tree, taking every node that keeps the running sum below target
+size_t FenwickTree::searchPrefix(long long target) const
+{
+    if (target <= 0)
+    {
+        return 0;
+    }
+    size_t step = 1;
+    while (step * 2 <= size())
+    {
+        step *= 2;
+    }
+    size_t position = 0;
+    for (; step > 0; step /= 2)
+    {
+        if (position + step <= size() && tree[position + step] < target)
+        {
+            position += step;
+            target -= tree[position];
+        }
+    }
+    return position + 1;
+}
+
+// Returns the number of entries
+size_t FenwickTree::size() const
+{
+    return tree.size() - 1;
+}
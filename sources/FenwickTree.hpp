@@ -0,0 +1,48 @@
+#ifndef FENWICKTREE_HPP
+#define FENWICKTREE_HPP
+
+#include <cstddef>
+#include <vector>
+
+using namespace std;
+
+namespace ariel
+{
+    // Binary indexed tree over a sequence of 64-bit values.
+    // Supports point updates, prefix sums and prefix-sum search in O(log n).
+    class FenwickTree
+    {
+    private:
+        vector<long long> tree;// 1-based partial sums, tree[0] is unused
+
+    public:
+        FenwickTree();
+
+        // Rebuilds the tree from the given values in O(n).
+        void assign(const vector<long long> &values);
+
+        // Resets the tree to hold count zeros.
+        void reset(size_t count);
+
+        // Appends an entry holding value in O(log n).
+        void push_back(long long value);
+
+        // Adds delta to the entry at the given position.
+        void add(size_t position, long long delta);
+
+        // Returns the sum of the first count entries.
+        long long prefixSum(size_t count) const;
+
+        // Returns the sum of the entries in [first, last).
+        long long rangeSum(size_t first, size_t last) const;
+
+        // Returns the smallest count whose prefix sum reaches target.
+        // The entries must be non-negative; returns size() + 1 if target is never reached.
+        size_t searchPrefix(long long target) const;
+
+        // Returns the number of entries.
+        size_t size() const;
+    };
+}
+
+#endif // FENWICKTREE_HPP
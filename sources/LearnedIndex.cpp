@@ -0,0 +1,114 @@
+#include "LearnedIndex.hpp"
+#include "SearchIndex.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+using namespace ariel;
+using namespace std;
+
+// Default constructor for LearnedIndex, creates an empty model
+LearnedIndex::LearnedIndex() : epsilon(0), drift(0), built(false)
+{
+}
+
+// Shrinking-cone segmentation: a segment grows while some slope keeps every point within epsilon
+void LearnedIndex::build(const vector<int> &values, size_t maxError)
+{
+    segments.clear();
+    epsilon = maxError;
+    drift = 0;
+    built = true;
+
+    double error = static_cast<double>(maxError);
+    size_t i = 0;
+    while (i < values.size())
+    {
+        Segment segment{values[i], 0.0, static_cast<double>(i)};
+        double lowSlope = 0.0;
+        double highSlope = numeric_limits<double>::infinity();
+
+        // Only the first copy of every key matters for a lower bound
+        size_t next = i + 1;
+        while (next < values.size())
+        {
+            if (values[next] == values[next - 1])
+            {
+                ++next;
+                continue;
+            }
+            double dx = static_cast<double>(values[next]) - static_cast<double>(segment.firstKey);
+            double dy = static_cast<double>(next) - segment.intercept;
+            double low = max(lowSlope, (dy - error) / dx);
+            double high = min(highSlope, (dy + error) / dx);
+            if (low > high)
+            {
+                break;
+            }
+            lowSlope = low;
+            highSlope = high;
+            ++next;
+        }
+        segment.slope = isinf(highSlope) ? lowSlope : (lowSlope + highSlope) / 2.0;
+        segments.push_back(segment);
+        i = next;
+    }
+}
+
+// Records count single-element insertions or removals
+void LearnedIndex::recordMutations(size_t count)
+{
+    drift += count;
+}
+
+// Drops the model after a bulk change it cannot track
+void LearnedIndex::invalidate()
+{
+    built = false;
+}
+
+// Returns true if the model was built and has not been invalidated
+bool LearnedIndex::isBuilt() const
+{
+    return built;
+}
+
+// Returns the number of mutations recorded since the build
+size_t LearnedIndex::driftSinceBuild() const
+{
+    return drift;
+}
+
+// Returns the number of segments
+size_t LearnedIndex::segmentCount() const
+{
+    return segments.size();
+}
+
+// Predicts the position of key, then searches the error window around the prediction
+size_t LearnedIndex::lowerBound(const vector<int> &values, int key) const
+{
+    size_t count = values.size();
+    if (segments.empty() || count == 0)
+    {
+        return branchlessLowerBound(values.data(), count, key);
+    }
+
+    // Pick the last segment starting at or before key
+    auto it = upper_bound(segments.begin(), segments.end(), key,
+                          [](int probe, const Segment &segment) { return probe < segment.firstKey; });
+    const Segment &segment = (it == segments.begin()) ? segments.front() : *(it - 1);
+    double predicted = segment.intercept + segment.slope * (static_cast<double>(key) - static_cast<double>(segment.firstKey));
+    predicted = min(max(predicted, 0.0), static_cast<double>(count));
+
+    // The answer provably lies in [first, last] if the keys just outside the window bracket it
+    size_t radius = epsilon + drift + 1;
+    size_t center = static_cast<size_t>(predicted);
+    size_t first = center > radius ? center - radius : 0;
+    size_t last = min(count, center + radius + 1);
+    bool bracketed = (first == 0 || values[first - 1] < key) && (last == count || values[last] >= key);
+    if (!bracketed)
+    {
+        return branchlessLowerBound(values.data(), count, key);
+    }
+    return first + branchlessLowerBound(values.data() + first, last - first, key);
+}
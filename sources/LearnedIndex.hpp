@@ -0,0 +1,57 @@
+#ifndef LEARNEDINDEX_HPP
+#define LEARNEDINDEX_HPP
+
+#include <cstddef>
+#include <vector>
+
+using namespace std;
+
+namespace ariel
+{
+    // Piecewise-linear model of the position of every distinct key in a sorted array.
+    // Each segment predicts positions within epsilon of the truth; a lookup evaluates the
+    // model and finishes with a short search inside the error window.
+    class LearnedIndex
+    {
+    private:
+        struct Segment
+        {
+            int firstKey;// Smallest key covered by the segment
+            double slope;// Positions per key unit
+            double intercept;// Position of firstKey
+        };
+
+        vector<Segment> segments;// Segments ordered by firstKey
+        size_t epsilon;// Maximal prediction error at build time
+        size_t drift;// Single-element mutations applied to the array since the build
+        bool built;// Whether the model describes the array at all
+
+    public:
+        LearnedIndex();
+
+        // Fits the segments to the sorted values in one greedy pass.
+        void build(const vector<int> &values, size_t maxError);
+
+        // Records count single-element insertions or removals: each moves every position by
+        // at most one, so the model stays usable with an error window widened by the drift.
+        void recordMutations(size_t count);
+
+        // Drops the model after a bulk change it cannot track.
+        void invalidate();
+
+        // Returns true if the model was built and has not been invalidated.
+        bool isBuilt() const;
+
+        // Returns the number of mutations recorded since the build.
+        size_t driftSinceBuild() const;
+
+        // Returns the number of segments.
+        size_t segmentCount() const;
+
+        // Returns the number of values smaller than key. Falls back to a binary search
+        // over the whole array when the answer lies outside the error window.
+        size_t lowerBound(const vector<int> &values, int key) const;
+    };
+}
+
+#endif // LEARNEDINDEX_HPP
@@ -0,0 +1,363 @@
+#include "LsmStore.hpp"
+#include <algorithm>
+#include <climits>
+#include <queue>
+#include <tuple>
+using namespace ariel;
+using namespace std;
+
+// Constructor for LsmStore with the given memtable size and level growth factor
+LsmStore::LsmStore(size_t memtableCapacity, size_t growthFactor)
+    : memtableCapacity(max<size_t>(memtableCapacity, 1)), growthFactor(max<size_t>(growthFactor, 2)),
+      liveCount(0), cursorValid(false), cursorValue(0), cursorRank(0), cursorCopies(0)
+{
+}
+
+// Returns a deep copy of the store
+unique_ptr<StorageBackend> LsmStore::clone() const
+{
+    return make_unique<LsmStore>(*this);
+}
+
+// Merges two runs, summing the deltas of equal values
+LsmStore::Run LsmStore::mergeRuns(const Run &first, const Run &second)
+{
+    Run merged;
+    merged.reserve(first.size() + second.size());
+    size_t i = 0;
+    size_t j = 0;
+    while (i < first.size() || j < second.size())
+    {
+        Entry entry{};
+        if (j == second.size() || (i < first.size() && first[i].value < second[j].value))
+        {
+            entry = first[i++];
+        }
+        else if (i == first.size() || second[j].value < first[i].value)
+        {
+            entry = second[j++];
+        }
+        else
+        {
+            entry = Entry{first[i].value, first[i].delta + second[j].delta, 0};
+            ++i;
+            ++j;
+        }
+        // A tombstone that met its insertions disappears along with them
+        if (entry.delta != 0)
+        {
+            merged.push_back(entry);
+        }
+    }
+    sumDeltas(merged);
+    return merged;
+}
+
+// Recomputes the running delta totals of a run from the given entry on
+void LsmStore::sumDeltas(Run &run, size_t first)
+{
+    long long total = first == 0 ? 0 : run[first - 1].before + run[first - 1].delta;
+    for (size_t i = first; i < run.size(); ++i)
+    {
+        run[i].before = total;
+        total += run[i].delta;
+    }
+}
+
+// Returns the maximal number of entries of the given level
+size_t LsmStore::levelCapacity(size_t level) const
+{
+    size_t capacity = memtableCapacity;
+    for (size_t i = 0; i <= level; ++i)
+    {
+        capacity *= growthFactor;
+    }
+    return capacity;
+}
+
+// Records delta copies of value in the memtable
+void LsmStore::addDelta(int value, long long delta)
+{
+    auto it = lower_bound(memtable.begin(), memtable.end(), value,
+                          [](const Entry &entry, int key) { return entry.value < key; });
+    auto position = static_cast<size_t>(it - memtable.begin());
+    if (it != memtable.end() && it->value == value)
+    {
+        it->delta += delta;
+        if (it->delta == 0)
+        {
+            memtable.erase(it);
+        }
+    }
+    else
+    {
+        memtable.insert(it, Entry{value, delta, 0});
+    }
+    // The memtable is small, and the insertion above already moved its tail
+    sumDeltas(memtable, position);
+    cursorValid = false;
+    if (memtable.size() >= memtableCapacity)
+    {
+        flush();
+    }
+}
+
+// Moves the memtable into level 0 and pushes overflowing levels down
+void LsmStore::flush()
+{
+    Run carry;
+    carry.swap(memtable);
+    for (size_t level = 0; !carry.empty(); ++level)
+    {
+        if (level == levels.size())
+        {
+            levels.emplace_back();
+        }
+        Run merged = mergeRuns(carry, levels[level]);
+        carry.clear();
+        if (merged.size() > levelCapacity(level))
+        {
+            // The level overflows, so its whole content moves one level down
+            carry.swap(merged);
+            levels[level].clear();
+        }
+        else
+        {
+            levels[level].swap(merged);
+        }
+    }
+}
+
+// Returns the net number of copies of value
+long long LsmStore::countOf(int value) const
+{
+    long long count = 0;
+    auto probe = [value, &count](const Run &run)
+    {
+        auto it = lower_bound(run.begin(), run.end(), value,
+                              [](const Entry &entry, int key) { return entry.value < key; });
+        if (it != run.end() && it->value == value)
+        {
+            count += it->delta;
+        }
+    };
+    probe(memtable);
+    for (const Run &run : levels)
+    {
+        probe(run);
+    }
+    return count;
+}
+
+// Sums, over every run, the deltas of the entries below bound
+size_t LsmStore::countBelow(long long bound) const
+{
+    long long count = 0;
+    auto probe = [bound, &count](const Run &run)
+    {
+        auto it = lower_bound(run.begin(), run.end(), bound,
+                              [](const Entry &entry, long long key) { return entry.value < key; });
+        if (it != run.end())
+        {
+            count += it->before;
+        }
+        else if (!run.empty())
+        {
+            count += run.back().before + run.back().delta;
+        }
+    };
+    probe(memtable);
+    for (const Run &run : levels)
+    {
+        probe(run);
+    }
+    return static_cast<size_t>(count);
+}
+
+// Points the cursor at value
+void LsmStore::moveCursor(int value) const
+{
+    cursorValue = value;
+    cursorRank = countBelow(value);
+    cursorCopies = countBelow(static_cast<long long>(value) + 1) - cursorRank;
+    cursorValid = true;
+}
+
+// Replaces the contents with the given sorted values, stored as one level
+void LsmStore::assign(const vector<int> &sorted)
+{
+    Run run;
+    for (int value : sorted)
+    {
+        if (!run.empty() && run.back().value == value)
+        {
+            ++run.back().delta;
+        }
+        else
+        {
+            run.push_back(Entry{value, 1, 0});
+        }
+    }
+    sumDeltas(run);
+    memtable.clear();
+    levels.clear();
+    size_t level = 0;
+    while (levelCapacity(level) < run.size())
+    {
+        ++level;
+    }
+    levels.resize(level + 1);
+    levels[level].swap(run);
+    liveCount = sorted.size();
+    cursorValid = false;
+}
+
+// Inserts one copy of value
+void LsmStore::insert(int value)
+{
+    ++liveCount;
+    addDelta(value, 1);
+}
+
+// Removes one copy of value by writing a tombstone
+bool LsmStore::erase(int value)
+{
+    if (countOf(value) <= 0)
+    {
+        return false;
+    }
+    --liveCount;
+    addDelta(value, -1);
+    return true;
+}
+
+// Returns the number of stored values
+size_t LsmStore::size() const
+{
+    return liveCount;
+}
+
+// Steps the cursor to the next value while reading in order, and otherwise searches the value domain
+int LsmStore::select(size_t k) const
+{
+    if (cursorValid && k >= cursorRank && k < cursorRank + cursorCopies)
+    {
+        return cursorValue;
+    }
+    if (cursorValid && k == cursorRank + cursorCopies)
+    {
+        // The next value is the smallest entry past the cursor in some run; tombstones that cancel
+        // every copy of a value are skipped until the runs holding them merge
+        for (long long after = cursorValue; after < INT_MAX;)
+        {
+            long long next = static_cast<long long>(INT_MAX) + 1;
+            auto probe = [after, &next](const Run &run)
+            {
+                auto it = upper_bound(run.begin(), run.end(), after,
+                                      [](long long key, const Entry &entry) { return key < entry.value; });
+                if (it != run.end())
+                {
+                    next = min<long long>(next, it->value);
+                }
+            };
+            probe(memtable);
+            for (const Run &run : levels)
+            {
+                probe(run);
+            }
+            if (next > INT_MAX)
+            {
+                break;
+            }
+            moveCursor(static_cast<int>(next));
+            if (cursorCopies > 0)
+            {
+                return cursorValue;
+            }
+            after = next;
+        }
+    }
+    // Smallest value with more than k stored values not greater than it
+    long long low = INT_MIN;
+    long long high = INT_MAX;
+    while (low < high)
+    {
+        long long middle = low + (high - low) / 2;
+        if (countBelow(middle + 1) > k)
+        {
+            high = middle;
+        }
+        else
+        {
+            low = middle + 1;
+        }
+    }
+    moveCursor(static_cast<int>(low));
+    return cursorValue;
+}
+
+// Returns the number of stored values smaller than value
+size_t LsmStore::rank(int value) const
+{
+    return countBelow(value);
+}
+
+// Expands the runs by a k-way merge straight into out
+void LsmStore::appendTo(vector<int> &out) const
+{
+    vector<const Run *> runs{&memtable};
+    for (const Run &run : levels)
+    {
+        runs.push_back(&run);
+    }
+
+    // Min-heap of (value, run, position) over the heads of the runs
+    using Head = tuple<int, size_t, size_t>;
+    priority_queue<Head, vector<Head>, greater<Head>> heads;
+    for (size_t r = 0; r < runs.size(); ++r)
+    {
+        if (!runs[r]->empty())
+        {
+            heads.emplace((*runs[r])[0].value, r, 0);
+        }
+    }
+
+    out.reserve(out.size() + liveCount);
+    while (!heads.empty())
+    {
+        int value = get<0>(heads.top());
+        long long copies = 0;
+        // Sum the deltas every run holds for this value
+        while (!heads.empty() && get<0>(heads.top()) == value)
+        {
+            auto [headValue, r, position] = heads.top();
+            heads.pop();
+            copies += (*runs[r])[position].delta;
+            if (position + 1 < runs[r]->size())
+            {
+                heads.emplace((*runs[r])[position + 1].value, r, position + 1);
+            }
+        }
+        for (long long i = 0; i < copies; ++i)
+        {
+            out.push_back(value);
+        }
+    }
+}
+
+// Returns the approximate number of bytes the runs occupy
+size_t LsmStore::memoryUsage() const
+{
+    size_t entries = memtable.capacity();
+    for (const Run &run : levels)
+    {
+        entries += run.capacity();
+    }
+    return entries * sizeof(Entry);
+}
+
+// Returns the number of levels below the memtable
+size_t LsmStore::levelCount() const
+{
+    return levels.size();
+}
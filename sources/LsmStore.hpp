@@ -0,0 +1,80 @@
+#ifndef LSMSTORE_HPP
+#define LSMSTORE_HPP
+
+#include "StorageBackend.hpp"
+
+namespace ariel
+{
+    // Log-structured merge storage: a small sorted in-memory run absorbs inserts and deletes,
+    // and fills geometrically larger immutable sorted levels by merging into them when full.
+    // Every write costs O(log n) amortized moves whatever the size of the container. Reads never
+    // merge the runs: a rank sums one binary search per run over running delta totals, a select
+    // searches the value domain with those ranks, and a cursor steps consecutive selects through
+    // the runs, so iterating costs one probe per run and element.
+    class LsmStore : public StorageBackend
+    {
+    private:
+        struct Entry
+        {
+            int value;
+            long long delta;// Net insertions of value; negative entries are tombstones
+            long long before;// Sum of the deltas of the entries before this one in its run
+        };
+
+        using Run = vector<Entry>;// Entries sorted by value, one per distinct value
+
+        size_t memtableCapacity;// Entries the in-memory run holds before it is flushed
+        size_t growthFactor;// Capacity ratio between consecutive levels
+        Run memtable;// Newest writes
+        vector<Run> levels;// Level i holds at most memtableCapacity * growthFactor^(i + 1) entries
+        size_t liveCount;// Number of stored values
+
+        // Last value select() returned, with its position range, while no write happened since
+        mutable bool cursorValid;
+        mutable int cursorValue;
+        mutable size_t cursorRank;// Number of stored values smaller than cursorValue
+        mutable size_t cursorCopies;// Number of copies of cursorValue
+
+        // Merges two runs, summing the deltas of equal values and dropping the ones that cancel out.
+        static Run mergeRuns(const Run &first, const Run &second);
+
+        // Recomputes the running delta totals of a run from the given entry on.
+        static void sumDeltas(Run &run, size_t first = 0);
+
+        // Returns the maximal number of entries of the given level.
+        size_t levelCapacity(size_t level) const;
+
+        // Records delta copies of value in the memtable.
+        void addDelta(int value, long long delta);
+
+        // Moves the memtable into level 0 and pushes overflowing levels down.
+        void flush();
+
+        // Returns the net number of copies of value.
+        long long countOf(int value) const;
+
+        // Returns the number of stored values smaller than bound, which may exceed the int range.
+        size_t countBelow(long long bound) const;
+
+        // Points the cursor at value and counts its copies and the values below it.
+        void moveCursor(int value) const;
+
+    public:
+        LsmStore(size_t memtableCapacity = 64, size_t growthFactor = 4);
+
+        unique_ptr<StorageBackend> clone() const override;
+        void assign(const vector<int> &sorted) override;
+        void insert(int value) override;
+        bool erase(int value) override;
+        size_t size() const override;
+        int select(size_t k) const override;
+        size_t rank(int value) const override;
+        void appendTo(vector<int> &out) const override;
+        size_t memoryUsage() const override;
+
+        // Returns the number of levels below the memtable.
+        size_t levelCount() const;
+    };
+}
+
+#endif // LSMSTORE_HPP
@@ -1,99 +1,1884 @@
 #include "MagicalContainer.hpp"
+#include "DenseStore.hpp"
+#include "EliasFano.hpp"
+#include "LsmStore.hpp"
+#include "PackedStore.hpp"
+#include "PrimalityKernel.hpp"
+#include "PrimalityOracle.hpp"
+#include "RoaringStore.hpp"
+#include "RunLengthStore.hpp"
+#include <algorithm>
+#include <bit>
+#include <climits>
+#include <cmath>
+#include <numeric>
 using namespace ariel;
 using namespace std;
 
+namespace
+{
+    // Expands two pointers outwards from split, the number of entries smaller than value,
+    // taking the closer neighbour each step; at(i) reads the i-th entry of a sorted sequence.
+    template <typename Accessor>
+    vector<int> expandAround(int value, size_t split, size_t count, size_t k, Accessor at)
+    {
+        vector<int> result;
+        size_t left = split;// Entries [0, left) are still candidates on the left
+        size_t right = split;// Entries [right, count) are still candidates on the right
+        while (result.size() < k && (left > 0 || right < count))
+        {
+            bool takeLeft = right == count ||
+                            (left > 0 && static_cast<long long>(value) - at(left - 1) <=
+                                             static_cast<long long>(at(right)) - value);
+            result.push_back(takeLeft ? at(--left) : at(right++));
+        }
+        return result;
+    }
+
+    // Marks the first live copy of value as deleted in a tombstoned sorted array and in its prime
+    // subset; position is the lower bound of value over all slots. Returns the deleted slot, or
+    // numbers.size() if value has no live copy.
+    size_t buryValue(const vector<int> &numbers, const vector<int *> &primes, TombstoneSet &dead,
+                     TombstoneSet &deadPrimes, FenwickTree *sums, FenwickTree *primeSums, int value, size_t position)
+    {
+        size_t rank = dead.liveBefore(position);
+        if (rank == numbers.size() - dead.deadCount())
+        {
+            return numbers.size();
+        }
+        size_t slot = dead.slotOfLive(rank);
+        if (numbers[slot] != value)
+        {
+            return numbers.size();
+        }
+        dead.kill(slot);
+        if (sums != nullptr)
+        {
+            sums->add(slot, -value);
+        }
+
+        // A prime value has as many live copies in the subset as in the array
+        auto it = lower_bound(primes.begin(), primes.end(), value,
+                              [](const int *prime, int key) { return *prime < key; });
+        if (it != primes.end() && **it == value)
+        {
+            size_t primeSlot = deadPrimes.slotOfLive(deadPrimes.liveBefore(static_cast<size_t>(it - primes.begin())));
+            deadPrimes.kill(primeSlot);
+            if (primeSums != nullptr)
+            {
+                primeSums->add(primeSlot, -value);
+            }
+        }
+        return slot;
+    }
+
+    // Returns the absolute value of value, which is representable for INT_MIN as well
+    uint32_t magnitudeOf(int value)
+    {
+        return value < 0 ? 0U - static_cast<uint32_t>(value) : static_cast<uint32_t>(value);
+    }
+
+    // Asks the process-wide oracle, in the form the frozen layout takes its classifier
+    bool sharedIsPrime(int value)
+    {
+        return PrimalityOracle::shared().isPrime(value);
+    }
+
+    // Classifies sorted values in one batch, by a segmented sieve when they are dense enough;
+    // bit i of the result is set iff values[i] is prime
+    vector<uint64_t> primeMaskOf(span<const int> sorted)
+    {
+        vector<uint64_t> mask((sorted.size() + 63) / 64);
+        classifySortedPrimes(sorted, mask);
+        return mask;
+    }
+
+    // Creates an empty backend for every layout other than SortedVector, sized for the sorted elements
+    unique_ptr<StorageBackend> makeBackend(MagicalContainer::StorageLayout layout, const vector<int> &elements)
+    {
+        switch (layout)
+        {
+        case MagicalContainer::StorageLayout::Dense:
+            return elements.empty() ? make_unique<DenseStore>(0, 63)
+                                    : make_unique<DenseStore>(elements.front(), elements.back());
+        case MagicalContainer::StorageLayout::LogStructured:
+            return make_unique<LsmStore>();
+        case MagicalContainer::StorageLayout::RunLength:
+            return make_unique<RunLengthStore>();
+        case MagicalContainer::StorageLayout::Roaring:
+            return make_unique<RoaringStore>();
+        case MagicalContainer::StorageLayout::BlockPacked:
+            return make_unique<PackedStore>();
+        case MagicalContainer::StorageLayout::Frozen:
+            return make_unique<EliasFano>(sharedIsPrime);
+        default:
+            return nullptr;
+        }
+    }
+}
+
 // Default constructor for MagicalContainer
 MagicalContainer::MagicalContainer()
+    : sumIndexEnabled(false), readIndexEnabled(false), readIndexStale(false),
+      learnedIndexEnabled(false), learnedRebuildAfter(0), learnedMaxError(0),
+      tombstonesEnabled(false), compactionThreshold(0.25), compactionStep(1024), compacting(false),
+      insertBufferEnabled(false), insertBufferCapacity(0), layout(StorageLayout::SortedVector),
+      thawedLayout(StorageLayout::SortedVector),
+      uniqueEnabled(false), uniqueFilterEnabled(false), membershipFilterEnabled(false), payloadsEnabled(false),
+      adaptiveEnabled(false),
+      adaptiveWindow(4096), adapting(false)
+{
+}
+
+// Adds an element to the container while maintaining sorted order.
+bool MagicalContainer::addElement(int element)
+{
+    return admitElement(element, 0, 0);
+}
+
+// Adds an element carrying the given payload
+bool MagicalContainer::addElement(int element, uint64_t recordId, uint32_t flags)
+{
+    requirePayloads();
+    return admitElement(element, recordId, flags);
+}
+
+// Adds an element unless unique mode rejects it
+bool MagicalContainer::admitElement(int element, uint64_t recordId, uint32_t flags)
+{
+    requireThawed();
+    observeWorkload();
+    if (uniqueEnabled)
+    {
+        // The filter settles duplicates without a search or a shift of the storage
+        bool present = uniqueFilterEnabled ? members.count(element) != 0 : contains(element);
+        if (present)
+        {
+            return false;
+        }
+    }
+    insertElement(element, recordId, flags);
+    if (uniqueFilterEnabled)
+    {
+        members.insert(element);
+    }
+    if (membershipFilterEnabled && membershipFilter.overloaded())
+    {
+        rebuildMembershipFilter();
+    }
+    return true;
+}
+
+// Inserts one copy of the element into the storage, then into the filter and the secondary indexes,
+// so that a layout rejecting the value leaves every structure as it was
+void MagicalContainer::insertElement(int element, uint64_t recordId, uint32_t flags)
+{
+    ++workload.writes;
+    storeElement(element, recordId, flags);
+    if (membershipFilterEnabled)
+    {
+        membershipFilter.add(element);
+    }
+    for (SecondaryIndex &index : secondaryIndexes)
+    {
+        index.insert(element);
+    }
+}
+
+// Inserts one copy of the element into whichever storage the layout uses
+void MagicalContainer::storeElement(int element, uint64_t recordId, uint32_t flags)
+{
+    if (store && adaptiveEnabled && !store->accepts(element))
+    {
+        // The adaptive layout picked a store that cannot hold the value, so a plain insert must not fail
+        // on its account: fall back to the general layout, and let the next decision reconsider
+        setStorageLayout(StorageLayout::SortedVector);
+    }
+    if (store)
+    {
+        // Only the dense layout rejects values, and it tracks the primes itself
+        store->insert(element);
+        if (primeStore && isPrime(element))
+        {
+            primeStore->insert(element);
+        }
+        return;
+    }
+
+    if (insertBufferEnabled)
+    {
+        pendingInserts.push_back(element);
+        if (pendingInserts.size() >= insertBufferCapacity)
+        {
+            mergePendingInserts();
+        }
+        return;
+    }
+
+    // The insertion shifts numberList anyway, so reclaim the tombstones in the same pass
+    compactNow();
+
+    // Find the position where the element should be inserted to maintain sorted order
+    size_t position = searchPosition(element);
+
+    // Insert the element at the calculated position
+    numberList.insert(numberList.begin() + static_cast<ptrdiff_t>(position), element);
+    if (payloadsEnabled)
+    {
+        recordIds.insert(recordIds.begin() + static_cast<ptrdiff_t>(position), recordId);
+        flagWords.insert(flagWords.begin() + static_cast<ptrdiff_t>(position), flags);
+    }
+
+    // Rebuild the primeIndices vector and the enabled indexes
+    refreshIndices();
+}
+
+// Removes an element from the container, if it exists.
+void MagicalContainer::removeElement(int element)
+{
+    if (!tryRemoveElement(element))
+    {
+        // Throw an exception if the element does not exist in the container
+        throw std::runtime_error("The element could not be located within the magicContainer.");
+    }
+}
+
+// Removes an element from the container without throwing; returns false if it is missing.
+bool MagicalContainer::tryRemoveElement(int element)
+{
+    requireThawed();
+    observeWorkload();
+    // A value missing from the filter is missing from the storage as well
+    if (uniqueFilterEnabled && members.erase(element) == 0)
+    {
+        return false;
+    }
+    // Most misses end here without touching the storage
+    if (membershipFilterEnabled && !membershipFilter.mayContain(element))
+    {
+        return false;
+    }
+    if (!eraseElement(element))
+    {
+        return false;
+    }
+    if (membershipFilterEnabled)
+    {
+        membershipFilter.remove(element);
+    }
+    for (SecondaryIndex &index : secondaryIndexes)
+    {
+        index.erase(element);
+    }
+    return true;
+}
+
+// Removes one copy of the element from the storage
+bool MagicalContainer::eraseElement(int element)
+{
+    ++workload.writes;
+    if (store)
+    {
+        if (!store->erase(element))
+        {
+            return false;
+        }
+        if (primeStore && isPrime(element))
+        {
+            primeStore->erase(element);
+        }
+        return true;
+    }
+
+    // A value still waiting in the buffer is dropped from there without a merge
+    auto pending = std::find(pendingInserts.begin(), pendingInserts.end(), element);
+    if (pending != pendingInserts.end())
+    {
+        *pending = pendingInserts.back();
+        pendingInserts.pop_back();
+        return true;
+    }
+
+    // Find the position of the element in the container
+    size_t position = searchPosition(element);
+
+    if (tombstonesEnabled)
+    {
+        FenwickTree *sums = sumIndexEnabled ? &sumIndex : nullptr;
+        FenwickTree *primeSums = sumIndexEnabled ? &primeSumIndex : nullptr;
+        size_t slot = buryValue(numberList, primeIndices, tombstones, primeTombstones, sums, primeSums, element, position);
+        if (slot == numberList.size())
+        {
+            return false;
+        }
+        // A slot the compaction already copied must be deleted from the copy as well
+        if (compacting && slot < compaction.cursor)
+        {
+            sums = sumIndexEnabled ? &compaction.sums : nullptr;
+            primeSums = sumIndexEnabled ? &compaction.primeSums : nullptr;
+            buryValue(compaction.numbers, compaction.primes, compaction.dead, compaction.deadPrimes, sums, primeSums,
+                      element, branchlessLowerBound(compaction.numbers.data(), compaction.numbers.size(), element));
+        }
+        scheduleCompaction();
+        return true;
+    }
+
+    // Report a miss if the element does not exist in the container
+    if (position == numberList.size() || numberList[position] != element)
+    {
+        return false;
+    }
+    numberList.erase(numberList.begin() + static_cast<ptrdiff_t>(position));
+    if (payloadsEnabled)
+    {
+        recordIds.erase(recordIds.begin() + static_cast<ptrdiff_t>(position));
+        flagWords.erase(flagWords.begin() + static_cast<ptrdiff_t>(position));
+    }
+
+    // Rebuild the primeIndices vector and the enabled indexes after erasing an element
+    refreshIndices();
+    return true;
+}
+
+// Removes one copy of every listed value in a single compaction pass
+size_t MagicalContainer::removeElements(span<const int> numbers)
+{
+    requireThawed();
+    ++workload.scans;
+    if (store)
+    {
+        size_t missing = 0;
+        for (int number : numbers)
+        {
+            missing += tryRemoveElement(number) ? 0U : 1U;
+        }
+        return missing;
+    }
+    // Every value holds a single copy in unique mode, so each listed value leaves entirely
+    if (uniqueFilterEnabled)
+    {
+        for (int number : numbers)
+        {
+            members.erase(number);
+        }
+    }
+    settle();
+    compactNow();
+    vector<int> victims(numbers.begin(), numbers.end());
+    sort(victims.begin(), victims.end());
+
+    // Merge the sorted victims against numberList, sliding every survivor into place
+    vector<int> removedValues;
+    size_t missing = 0;
+    size_t victim = 0;
+    size_t write = 0;
+    for (size_t read = 0; read < numberList.size(); ++read)
+    {
+        // Victims smaller than the current element can no longer be matched
+        while (victim < victims.size() && victims[victim] < numberList[read])
+        {
+            ++missing;
+            ++victim;
+        }
+        if (victim < victims.size() && victims[victim] == numberList[read])
+        {
+            if (membershipFilterEnabled)
+            {
+                membershipFilter.remove(numberList[read]);
+            }
+            if (!secondaryIndexes.empty())
+            {
+                removedValues.push_back(numberList[read]);
+            }
+            ++victim;
+            continue;
+        }
+        moveSlot(read, write++);
+    }
+    missing += victims.size() - victim;
+
+    size_t removed = numberList.size() - write;
+    if (removed > 0)
+    {
+        truncateSlots(write);
+        refreshIndices(removed);
+        eraseFromSecondaryIndexes(removedValues);
+    }
+    return missing;
+}
+
+// Removes every element satisfying pred
+size_t MagicalContainer::removeIf(const function<bool(int)> &pred)
+{
+    requireThawed();
+    ++workload.scans;
+    if (uniqueFilterEnabled)
+    {
+        erase_if(members, pred);
+    }
+    // Forget every victim in the membership filter as it is found, and collect it for the secondary indexes
+    vector<int> removedValues;
+    auto victim = [this, &pred, &removedValues](int value)
+    {
+        if (!pred(value))
+        {
+            return false;
+        }
+        if (membershipFilterEnabled)
+        {
+            membershipFilter.remove(value);
+        }
+        if (!secondaryIndexes.empty())
+        {
+            removedValues.push_back(value);
+        }
+        return true;
+    };
+    if (store)
+    {
+        // Filter a sorted copy and rebuild the layout from it in bulk
+        vector<int> elements = getElements();
+        auto last = remove_if(elements.begin(), elements.end(), victim);
+        size_t removed = static_cast<size_t>(elements.end() - last);
+        if (removed > 0)
+        {
+            elements.erase(last, elements.end());
+            assignStores(elements);
+            eraseFromSecondaryIndexes(removedValues);
+        }
+        return removed;
+    }
+    settle();
+    compactNow();
+    // Slide every survivor into place, with its payload
+    size_t write = 0;
+    for (size_t read = 0; read < numberList.size(); ++read)
+    {
+        if (!victim(numberList[read]))
+        {
+            moveSlot(read, write++);
+        }
+    }
+    size_t removed = numberList.size() - write;
+    if (removed > 0)
+    {
+        truncateSlots(write);
+        refreshIndices(removed);
+        eraseFromSecondaryIndexes(removedValues);
+    }
+    return removed;
+}
+
+// Removes every element within [low, high]
+size_t MagicalContainer::removeRange(int low, int high)
+{
+    requireThawed();
+    if (low > high)
+    {
+        return 0;
+    }
+    if (store)
+    {
+        return removeIf([low, high](int value) { return value >= low && value <= high; });
+    }
+    if (uniqueFilterEnabled)
+    {
+        for (size_t i = lowerBoundPosition(low), last = upperBoundPosition(high); i < last; ++i)
+        {
+            members.erase(valueAt(i));
+        }
+    }
+    settle();
+    compactNow();
+    // The victims form one contiguous block, so a single erase closes the gap
+    size_t first = searchPosition(low);
+    size_t last = (high == INT_MAX) ? numberList.size() : searchPosition(high + 1);
+    if (first < last)
+    {
+        for (size_t i = first; membershipFilterEnabled && i < last; ++i)
+        {
+            membershipFilter.remove(numberList[i]);
+        }
+        if (!secondaryIndexes.empty())
+        {
+            eraseFromSecondaryIndexes(vector<int>(numberList.begin() + static_cast<ptrdiff_t>(first),
+                                                  numberList.begin() + static_cast<ptrdiff_t>(last)));
+        }
+        numberList.erase(numberList.begin() + static_cast<ptrdiff_t>(first),
+                         numberList.begin() + static_cast<ptrdiff_t>(last));
+        if (payloadsEnabled)
+        {
+            recordIds.erase(recordIds.begin() + static_cast<ptrdiff_t>(first),
+                            recordIds.begin() + static_cast<ptrdiff_t>(last));
+            flagWords.erase(flagWords.begin() + static_cast<ptrdiff_t>(first),
+                            flagWords.begin() + static_cast<ptrdiff_t>(last));
+        }
+        refreshIndices(last - first);
+    }
+    return last - first;
+}
+
+// Returns the size of the container
+size_t MagicalContainer::size() const
+{
+    if (store)
+    {
+        return store->size();
+    }
+    settle();
+    return numberList.size() - tombstones.deadCount();
+}
+
+// Returns the element at the given index
+int MagicalContainer::operator[](size_t index) const
+{
+    observeWorkload();
+    // If the index is out of range, throw an exception
+    if (index >= size())
+    {
+        throw std::out_of_range("The index exceeds the valid bounds.");
+    }
+    return valueAt(index);
+}
+
+// Reads the element at the given index into value without throwing
+bool MagicalContainer::tryGet(size_t index, int &value) const
+{
+    observeWorkload();
+    if (index >= size())
+    {
+        return false;
+    }
+    value = valueAt(index);
+    return true;
+}
+
+// Returns all the elements of the container in a vector
+vector<int> MagicalContainer::getElements() const
+{
+    ++workload.scans;
+    if (store)
+    {
+        vector<int> elements;
+        elements.reserve(store->size());
+        store->appendTo(elements);
+        return elements;
+    }
+    settle();
+    if (tombstones.deadCount() == 0)
+    {
+        return numberList;
+    }
+    vector<int> elements;
+    elements.reserve(size());
+    for (size_t slot = 0; slot < numberList.size(); ++slot)
+    {
+        if (!tombstones.isDead(slot))
+        {
+            elements.push_back(numberList[slot]);
+        }
+    }
+    return elements;
+}
+
+// Checks if a number is prime
+bool MagicalContainer::isPrime(int num) const
+{
+    return sharedIsPrime(num);
+}
+
+// Rebuilds primeIndices and every enabled index after numberList changed
+void MagicalContainer::refreshIndices(size_t changed) const
 {
+    // Clear the prime indices
+    primeIndices.clear();
+
+    // Rebuild the primeIndices vector from one batch classification of numberList
+    vector<uint64_t> primeMask = primeMaskOf(numberList);
+    for (size_t word = 0; word < primeMask.size(); ++word)
+    {
+        for (uint64_t bits = primeMask[word]; bits != 0; bits &= bits - 1)
+        {
+            primeIndices.push_back(&numberList[word * 64 + static_cast<size_t>(countr_zero(bits))]);
+        }
+    }
+
+    if (tombstonesEnabled)
+    {
+        tombstones.reset(numberList.size());
+        primeTombstones.reset(primeIndices.size());
+    }
+
+    // The read index is rebuilt by the next lookup rather than by every mutation
+    readIndexStale = readIndexEnabled;
+    if (learnedIndexEnabled)
+    {
+        learnedIndex.recordMutations(changed);
+    }
+
+    if (sumIndexEnabled)
+    {
+        // Both trees are built in linear time, the same cost as the vector shift that preceded
+        vector<long long> values(numberList.begin(), numberList.end());
+        sumIndex.assign(values);
+        values.clear();
+        for (const int *prime : primeIndices)
+        {
+            values.push_back(*prime);
+        }
+        primeSumIndex.assign(values);
+    }
+}
+
+// Returns the k-th live element
+int MagicalContainer::valueAt(size_t k) const
+{
+    ++workload.positional;
+    if (store)
+    {
+        return store->select(k);
+    }
+    return numberList[tombstones.slotOfLive(k)];
+}
+
+// Returns the slot of numberList holding the k-th live element
+size_t MagicalContainer::slotBoundary(size_t k) const
+{
+    return k >= size() ? numberList.size() : tombstones.slotOfLive(k);
+}
+
+// Returns the number of live prime elements
+size_t MagicalContainer::primeCount() const
+{
+    if (store)
+    {
+        return primeStore ? primeStore->size() : store->primeSize();
+    }
+    settle();
+    return primeIndices.size() - primeTombstones.deadCount();
+}
+
+// Returns the k-th live prime element
+int MagicalContainer::primeAt(size_t k) const
+{
+    ++workload.positional;
+    if (store)
+    {
+        return primeStore ? primeStore->select(k) : store->primeSelect(k);
+    }
+    return *primeIndices[primeTombstones.slotOfLive(k)];
+}
+
+// Returns the number of elements smaller than value for a mutation
+size_t MagicalContainer::searchPosition(int value) const
+{
+    if (learnedIndexEnabled)
+    {
+        // Refit lazily once the accumulated drift would make the error window too wide
+        if (!learnedIndex.isBuilt() || learnedIndex.driftSinceBuild() > learnedRebuildAfter)
+        {
+            learnedIndex.build(numberList, learnedMaxError);
+        }
+        return learnedIndex.lowerBound(numberList, value);
+    }
+    return branchlessLowerBound(numberList.data(), numberList.size(), value);
+}
+
+// Returns the number of live elements smaller than value, through the enabled accelerator
+size_t MagicalContainer::lowerBoundPosition(int value) const
+{
+    ++workload.lookups;
+    if (store)
+    {
+        return store->rank(value);
+    }
+    settle();
+    // Deleted slots keep their values, so the accelerators search every slot and the
+    // tombstones translate the slot into a count of live elements
+    size_t slot = 0;
+    if (learnedIndexEnabled)
+    {
+        slot = searchPosition(value);
+    }
+    else if (readIndexEnabled)
+    {
+        if (readIndexStale)
+        {
+            readIndex.build(numberList);
+            readIndexStale = false;
+        }
+        slot = readIndex.lowerBound(value);
+    }
+    else
+    {
+        slot = branchlessLowerBound(numberList.data(), numberList.size(), value);
+    }
+    return tombstones.liveBefore(slot);
+}
+
+// Returns the number of live elements not greater than value
+size_t MagicalContainer::upperBoundPosition(int value) const
+{
+    return (value == INT_MAX) ? size() : lowerBoundPosition(value + 1);
+}
+
+// Returns the number of live prime elements smaller than value
+size_t MagicalContainer::primesBelow(int value) const
+{
+    ++workload.lookups;
+    if (store)
+    {
+        return primeStore ? primeStore->rank(value) : store->primeRank(value);
+    }
+    settle();
+    auto it = lower_bound(primeIndices.begin(), primeIndices.end(), value,
+                          [](const int *prime, int key) { return *prime < key; });
+    return primeTombstones.liveBefore(static_cast<size_t>(it - primeIndices.begin()));
+}
+
+//*****Tombstones*****
+
+// Turns tombstone deletion on or off
+void MagicalContainer::setTombstoneMode(bool enabled, double threshold, size_t step)
+{
+    if (!(threshold > 0.0 && threshold <= 1.0) || step == 0)
+    {
+        throw std::invalid_argument("The threshold must lie within (0, 1] and the step must be positive.");
+    }
+    if (enabled)
+    {
+        requireSortedVector();
+        requireNoPayloads();
+    }
+    settle();
+    compactionThreshold = threshold;
+    compactionStep = step;
+    if (enabled == tombstonesEnabled)
+    {
+        return;
+    }
+    if (enabled)
+    {
+        tombstones.reset(numberList.size());
+        primeTombstones.reset(primeIndices.size());
+    }
+    else
+    {
+        compactNow();
+        tombstones = TombstoneSet();
+        primeTombstones = TombstoneSet();
+    }
+    tombstonesEnabled = enabled;
+}
+
+// Returns true if removals leave tombstones
+bool MagicalContainer::hasTombstoneMode() const
+{
+    return tombstonesEnabled;
+}
+
+// Returns the number of deleted slots not yet reclaimed
+size_t MagicalContainer::tombstoneCount() const
+{
+    return tombstones.deadCount();
+}
+
+// Starts a compaction once the dead fraction crosses the threshold and advances a running one
+void MagicalContainer::scheduleCompaction()
+{
+    if (!compacting && static_cast<double>(tombstones.deadCount()) > compactionThreshold * static_cast<double>(numberList.size()))
+    {
+        compaction = Compaction();
+        // Reserving up front keeps the pointers in compaction.primes valid while numbers grows
+        compaction.numbers.reserve(size());
+        compaction.primes.reserve(primeCount());
+        compaction.dead.reset(0);
+        compaction.deadPrimes.reset(0);
+        compacting = true;
+    }
+    if (compacting)
+    {
+        advanceCompaction(compactionStep);
+    }
+}
+
+// Copies up to budget more slots into the compaction and swaps it in once it is complete
+void MagicalContainer::advanceCompaction(size_t budget) const
+{
+    size_t end = numberList.size() - compaction.cursor > budget ? compaction.cursor + budget : numberList.size();
+    for (; compaction.cursor < end; ++compaction.cursor)
+    {
+        const int *slot = &numberList[compaction.cursor];
+        // primeIndices is ordered by slot, so a second cursor tells whether this slot is prime
+        while (compaction.primeCursor < primeIndices.size() && primeIndices[compaction.primeCursor] < slot)
+        {
+            ++compaction.primeCursor;
+        }
+        if (tombstones.isDead(compaction.cursor))
+        {
+            continue;
+        }
+        compaction.numbers.push_back(*slot);
+        compaction.dead.appendLive();
+        if (sumIndexEnabled)
+        {
+            compaction.sums.push_back(*slot);
+        }
+        if (compaction.primeCursor < primeIndices.size() && primeIndices[compaction.primeCursor] == slot)
+        {
+            compaction.primes.push_back(&compaction.numbers.back());
+            compaction.deadPrimes.appendLive();
+            if (sumIndexEnabled)
+            {
+                compaction.primeSums.push_back(*slot);
+            }
+        }
+    }
+    if (compaction.cursor < numberList.size())
+    {
+        return;
+    }
+
+    // Every structure of the copy was kept up to date, so swapping them in is O(1)
+    numberList.swap(compaction.numbers);
+    primeIndices.swap(compaction.primes);
+    tombstones = std::move(compaction.dead);
+    primeTombstones = std::move(compaction.deadPrimes);
+    if (sumIndexEnabled)
+    {
+        sumIndex = std::move(compaction.sums);
+        primeSumIndex = std::move(compaction.primeSums);
+    }
+    compaction = Compaction();
+    compacting = false;
+    readIndexStale = readIndexEnabled;
+    learnedIndex.invalidate();
+}
+
+// Reclaims every tombstone immediately
+void MagicalContainer::compactNow() const
+{
+    if (tombstones.deadCount() == 0 && !compacting)
+    {
+        return;
+    }
+    if (!compacting)
+    {
+        compaction = Compaction();
+        compaction.numbers.reserve(size());
+        compaction.primes.reserve(primeCount());
+        compacting = true;
+    }
+    advanceCompaction(numberList.size());
+}
+
+//*****Insert buffer*****
+
+// Turns the insert buffer on or off
+void MagicalContainer::setInsertBuffer(bool enabled, size_t capacity)
+{
+    if (capacity == 0)
+    {
+        throw std::invalid_argument("The buffer capacity must be positive.");
+    }
+    if (enabled)
+    {
+        requireSortedVector();
+        requireNoPayloads();
+    }
+    mergePendingInserts();
+    insertBufferEnabled = enabled;
+    insertBufferCapacity = capacity;
+}
+
+// Returns true if inserts go through the buffer
+bool MagicalContainer::hasInsertBuffer() const
+{
+    return insertBufferEnabled;
+}
+
+// Returns the number of inserts waiting in the buffer
+size_t MagicalContainer::pendingInsertCount() const
+{
+    return pendingInserts.size();
+}
+
+// Sorts the pending inserts and merges them into numberList in one linear pass
+void MagicalContainer::mergePendingInserts() const
+{
+    if (pendingInserts.empty())
+    {
+        return;
+    }
+    // Take the buffer first: the steps below read the container and would otherwise merge again
+    vector<int> incoming;
+    incoming.swap(pendingInserts);
+    compactNow();
+    sort(incoming.begin(), incoming.end());
+
+    // Merge from the back so that every element moves at most once
+    size_t read = numberList.size();
+    size_t pending = incoming.size();
+    numberList.resize(read + pending);
+    for (size_t write = numberList.size(); pending > 0; --write)
+    {
+        if (read > 0 && numberList[read - 1] > incoming[pending - 1])
+        {
+            numberList[write - 1] = numberList[--read];
+        }
+        else
+        {
+            numberList[write - 1] = incoming[--pending];
+        }
+    }
+    refreshIndices(incoming.size());
+}
+
+// Merges the pending inserts before a read
+void MagicalContainer::settle() const
+{
+    if (!pendingInserts.empty())
+    {
+        mergePendingInserts();
+    }
+}
+
+//*****Unique mode*****
+
+// Turns set semantics on or off, dropping the extra copies of duplicated values when enabling
+size_t MagicalContainer::setUniqueMode(bool enabled, bool hashFilter)
+{
+    if (enabled)
+    {
+        requireThawed();
+    }
+    uniqueEnabled = enabled;
+    uniqueFilterEnabled = false;
+    members.clear();
+    if (!enabled)
+    {
+        return 0;
+    }
+
+    vector<int> elements = getElements();
+    vector<int> extraCopies;
+    for (size_t i = 1; i < elements.size(); ++i)
+    {
+        if (elements[i] == elements[i - 1])
+        {
+            extraCopies.push_back(elements[i]);
+        }
+    }
+    removeElements(extraCopies);
+
+    if (hashFilter)
+    {
+        members.reserve(elements.size() - extraCopies.size());
+        members.insert(elements.begin(), elements.end());
+        uniqueFilterEnabled = true;
+    }
+    return extraCopies.size();
+}
+
+// Returns true if addElement rejects duplicates
+bool MagicalContainer::hasUniqueMode() const
+{
+    return uniqueEnabled;
+}
+
+//*****Membership filter*****
+
+// Turns the membership filter on or off
+void MagicalContainer::enableMembershipFilter(bool enabled)
+{
+    membershipFilterEnabled = enabled;
+    if (enabled)
+    {
+        rebuildMembershipFilter();
+    }
+    else
+    {
+        membershipFilter = MembershipFilter();
+    }
+}
+
+// Returns true if lookups go through the membership filter
+bool MagicalContainer::hasMembershipFilter() const
+{
+    return membershipFilterEnabled;
+}
+
+// Sizes the filter for twice the current elements, so refills stay rare as the container grows
+void MagicalContainer::rebuildMembershipFilter()
+{
+    vector<int> elements = getElements();
+    membershipFilter.reset(2 * elements.size());
+    for (int value : elements)
+    {
+        membershipFilter.add(value);
+    }
+}
+
+//*****Storage layouts*****
+
+// Throws unless the elements are kept in numberList for good
+void MagicalContainer::requireSortedVector() const
+{
+    if (store || adaptiveEnabled)
+    {
+        throw std::logic_error("This feature requires the fixed sorted-vector storage layout.");
+    }
+}
+
+// Replaces the contents of store and primeStore with the given sorted elements
+void MagicalContainer::assignStores(const vector<int> &elements) const
+{
+    store->assign(elements);
+    if (primeStore)
+    {
+        vector<int> primes;
+        vector<uint64_t> primeMask = primeMaskOf(elements);
+        for (size_t i = 0; i < elements.size(); ++i)
+        {
+            if ((primeMask[i / 64] >> (i % 64)) & 1)
+            {
+                primes.push_back(elements[i]);
+            }
+        }
+        primeStore->assign(primes);
+    }
+}
+
+// Moves every element into the given layout
+void MagicalContainer::setStorageLayout(StorageLayout newLayout)
+{
+    if (newLayout == layout)
+    {
+        return;
+    }
+    requireNoPayloads();
+    if (newLayout == StorageLayout::Frozen)
+    {
+        thawedLayout = layout;
+    }
+    vector<int> elements = getElements();
+    BackendHandle newStore;
+    if (newLayout != StorageLayout::SortedVector)
+    {
+        // Build the new store before touching anything, in case the layout rejects the elements
+        newStore = BackendHandle(makeBackend(newLayout, elements));
+
+        // The write modes and indexes only describe numberList
+        setTombstoneMode(false, compactionThreshold, compactionStep);
+        insertBufferEnabled = false;
+        enableSumIndex(false);
+        enableReadIndex(false);
+        enableLearnedIndex(false);
+    }
+    installLayout(newLayout, elements, std::move(newStore));
+}
+
+// Moves the sorted elements into numberList or into the given store
+void MagicalContainer::installLayout(StorageLayout newLayout, vector<int> &elements, BackendHandle newStore) const
+{
+    if (newLayout == StorageLayout::SortedVector)
+    {
+        store = BackendHandle();
+        primeStore = BackendHandle();
+        numberList.swap(elements);
+        refreshIndices(numberList.size());
+    }
+    else
+    {
+        BackendHandle newPrimeStore;
+        if (!newStore->tracksPrimes())
+        {
+            newPrimeStore = BackendHandle(makeBackend(newLayout, elements));
+        }
+        vector<int>().swap(numberList);
+        vector<int *>().swap(primeIndices);
+        store = std::move(newStore);
+        primeStore = std::move(newPrimeStore);
+        assignStores(elements);
+    }
+    layout = newLayout;
+}
+
+// Returns the layout the elements are kept in
+MagicalContainer::StorageLayout MagicalContainer::storageLayout() const
+{
+    return layout;
+}
+
+// Encodes the elements in the immutable Elias-Fano form
+void MagicalContainer::freeze()
+{
+    setStorageLayout(StorageLayout::Frozen);
+}
+
+// Decodes the elements back into the layout they were in before freeze()
+void MagicalContainer::thaw()
+{
+    if (layout == StorageLayout::Frozen)
+    {
+        setStorageLayout(thawedLayout);
+    }
+}
+
+// Returns true if the container is frozen
+bool MagicalContainer::isFrozen() const
+{
+    return layout == StorageLayout::Frozen;
+}
+
+// Throws if the container is frozen
+void MagicalContainer::requireThawed() const
+{
+    if (layout == StorageLayout::Frozen)
+    {
+        throw std::logic_error("The container is frozen; call thaw() before modifying it.");
+    }
+}
+
+//*****Adaptive layout*****
+
+// Turns the adaptive layout on or off
+void MagicalContainer::setAdaptiveLayout(bool enabled, size_t window)
+{
+    if (window == 0)
+    {
+        throw std::invalid_argument("The decision window must be positive.");
+    }
+    if (enabled && (tombstonesEnabled || insertBufferEnabled || sumIndexEnabled || readIndexEnabled || learnedIndexEnabled ||
+                    payloadsEnabled))
+    {
+        throw std::logic_error("The adaptive layout cannot be combined with the sorted-vector features.");
+    }
+    adaptiveEnabled = enabled;
+    adaptiveWindow = window;
+    workload = Workload();
+}
+
+// Returns true if the layout follows the workload
+bool MagicalContainer::hasAdaptiveLayout() const
+{
+    return adaptiveEnabled;
+}
+
+// Takes a layout decision once a window of operations has been observed
+void MagicalContainer::observeWorkload() const
+{
+    if (!adaptiveEnabled || adapting || layout == StorageLayout::Frozen)
+    {
+        return;
+    }
+    if (workload.writes + workload.lookups + workload.positional + workload.scans < adaptiveWindow)
+    {
+        return;
+    }
+    // A migration moves the elements without changing them, so a read may take it like it merges the buffer
+    adaptLayout();
+}
+
+// Prices the last window under every layout, in element moves and probes, and migrates to the cheapest
+void MagicalContainer::adaptLayout() const
+{
+    adapting = true;
+    Workload mix = workload;
+    double n = static_cast<double>(size());
+    double logN = log2(n + 2);
+
+    // Density of the values, and the share of neighbouring positions holding equal values, from a sample
+    double span = 0;
+    double duplicateShare = 0;
+    if (n >= 2)
+    {
+        size_t last = size() - 1;
+        span = static_cast<double>(static_cast<long long>(valueAt(last)) - valueAt(0) + 1);
+        const size_t samples = min<size_t>(64, last);
+        size_t equalPairs = 0;
+        for (size_t i = 0; i < samples; ++i)
+        {
+            size_t position = i * last / samples;
+            equalPairs += (valueAt(position) == valueAt(position + 1)) ? 1U : 0U;
+        }
+        duplicateShare = static_cast<double>(equalPairs) / static_cast<double>(samples);
+    }
+    double distinct = n * (1 - duplicateShare);
+
+    auto price = [&mix](double write, double lookup, double positional, double scan)
+    {
+        return static_cast<double>(mix.writes) * write + static_cast<double>(mix.lookups) * lookup +
+               static_cast<double>(mix.positional) * positional + static_cast<double>(mix.scans) * scan;
+    };
+    vector<pair<StorageLayout, double>> costs{
+        // Every write shifts the array and rebuilds the prime pointers
+        {StorageLayout::SortedVector, price(n, logN, 1, n)},
+        // Writes are cheap, reads search every level, and a random select searches the value domain
+        {StorageLayout::LogStructured, price(logN, logN * logN / 2, 16 * logN, n)},
+        // A copy of a present value is a counter update, a new value shifts the runs
+        {StorageLayout::RunLength, price(logN + (1 - duplicateShare) * distinct, logN, logN, n)},
+        // Writes shift within a chunk at most, reads select inside a chunk
+        {StorageLayout::Roaring, price(logN + 64, logN + 16, logN + 16, n)},
+        // Writes and random reads decode a whole block, sequential reads reuse the decoded one
+        {StorageLayout::BlockPacked, price(logN + 256, logN + 128, logN + 128, n)}};
+    // The bitmap only pays off while it is not much larger than the values themselves
+    if (span > 0 && span <= 64 * n + 4096 && span <= static_cast<double>(1 << 30))
+    {
+        double logWords = log2(span / 64 + 2);
+        costs.emplace_back(StorageLayout::Dense, price(logWords, logWords, logWords, span / 64 + n));
+    }
+
+    // A layout missing from the candidates no longer suits the values and is left whatever the saving
+    double current = HUGE_VAL;
+    auto best = costs.front();
+    for (const auto &candidate : costs)
+    {
+        if (candidate.first == layout)
+        {
+            current = candidate.second;
+        }
+        if (candidate.second < best.second)
+        {
+            best = candidate;
+        }
+    }
+    // Moving the elements costs about two passes over them
+    if (best.first != layout && best.second + 2 * n < current)
+    {
+        // The adaptive layout keeps the write modes and indexes off, so only the elements move; the
+        // dense candidate is only priced for a span its store accepts
+        vector<int> elements = getElements();
+        BackendHandle newStore;
+        if (best.first != StorageLayout::SortedVector)
+        {
+            newStore = BackendHandle(makeBackend(best.first, elements));
+        }
+        installLayout(best.first, elements, std::move(newStore));
+    }
+    workload = Workload();
+    adapting = false;
+}
+
+// Returns the approximate number of bytes the element storage occupies
+size_t MagicalContainer::memoryUsage() const
+{
+    if (store)
+    {
+        return store->memoryUsage() + (primeStore ? primeStore->memoryUsage() : 0);
+    }
+    return numberList.capacity() * sizeof(int) + primeIndices.capacity() * sizeof(int *) +
+           pendingInserts.capacity() * sizeof(int) + recordIds.capacity() * sizeof(uint64_t) +
+           flagWords.capacity() * sizeof(uint32_t);
+}
+
+//*****Payloads*****
+
+// Turns the payload columns on or off
+void MagicalContainer::enablePayloads(bool enabled)
+{
+    if (enabled)
+    {
+        requireSortedVector();
+        if (tombstonesEnabled || insertBufferEnabled)
+        {
+            throw std::logic_error("The payload columns cannot be combined with the tombstone mode or the insert buffer.");
+        }
+    }
+    if (enabled == payloadsEnabled)
+    {
+        return;
+    }
+    payloadsEnabled = enabled;
+    if (enabled)
+    {
+        recordIds.assign(numberList.size(), 0);
+        flagWords.assign(numberList.size(), 0);
+    }
+    else
+    {
+        // Release the memory held by the columns
+        vector<uint64_t>().swap(recordIds);
+        vector<uint32_t>().swap(flagWords);
+    }
+}
+
+// Returns true if the elements carry payloads
+bool MagicalContainer::hasPayloads() const
+{
+    return payloadsEnabled;
+}
+
+// Throws if the payload columns are on
+void MagicalContainer::requireNoPayloads() const
+{
+    if (payloadsEnabled)
+    {
+        throw std::logic_error("This feature cannot be combined with the payload columns.");
+    }
+}
+
+// Throws unless the payload columns are on
+void MagicalContainer::requirePayloads() const
+{
+    if (!payloadsEnabled)
+    {
+        throw std::logic_error("The payload columns are not enabled.");
+    }
+}
+
+// Throws unless the payload columns are on and index is in range
+void MagicalContainer::requirePayloadAt(size_t index) const
+{
+    requirePayloads();
+    if (index >= numberList.size())
+    {
+        throw std::out_of_range("The index exceeds the valid bounds.");
+    }
+}
+
+// Returns the record ID of the element at the given index
+uint64_t MagicalContainer::recordIdAt(size_t index) const
+{
+    requirePayloadAt(index);
+    return recordIds[index];
+}
+
+// Returns the flags word of the element at the given index
+uint32_t MagicalContainer::flagsAt(size_t index) const
+{
+    requirePayloadAt(index);
+    return flagWords[index];
+}
+
+// Replaces the payload of the element at the given index
+void MagicalContainer::setPayloadAt(size_t index, uint64_t recordId, uint32_t flags)
+{
+    requirePayloadAt(index);
+    recordIds[index] = recordId;
+    flagWords[index] = flags;
+}
+
+//*****Secondary indexes*****
+
+// Builds a secondary index over the current elements
+size_t MagicalContainer::addSecondaryIndex(SecondaryIndex::KeyFunction key)
+{
+    SecondaryIndex index(std::move(key));
+    index.build(getElements());
+    secondaryIndexes.push_back(std::move(index));
+    return secondaryIndexes.size() - 1;
+}
+
+// Drops every secondary index
+void MagicalContainer::clearSecondaryIndexes()
+{
+    secondaryIndexes.clear();
+}
+
+// Returns the number of secondary indexes
+size_t MagicalContainer::secondaryIndexCount() const
+{
+    return secondaryIndexes.size();
+}
+
+// Removes the values of a bulk removal from every secondary index in one pass each
+void MagicalContainer::eraseFromSecondaryIndexes(const vector<int> &values)
+{
+    if (values.empty())
+    {
+        return;
+    }
+    for (SecondaryIndex &index : secondaryIndexes)
+    {
+        index.eraseAll(values);
+    }
+}
+
+//*****Prime factors*****
+
+// Looks n up in the factor cache, building or growing the cache first when n lies past it
+uint32_t MagicalContainer::smallestPrimeFactor(uint32_t n) const
+{
+    uint32_t limit = factorSieve.limit();
+    if (n > limit && limit < FactorSieve::maxLimit)
+    {
+        // The first build covers every element; later ones at least double the table
+        uint32_t wanted = max(n, 2 * limit);
+        if (limit == 0 && size() > 0)
+        {
+            wanted = max({wanted, magnitudeOf(valueAt(0)), magnitudeOf(valueAt(size() - 1))});
+        }
+        factorSieve.build(wanted);
+    }
+    return factorSieve.smallestFactor(n);
+}
+
+// Divides out the smallest prime factor until nothing is left
+vector<int> MagicalContainer::primeFactors(int value) const
+{
+    vector<int> factors;
+    for (uint32_t rest = magnitudeOf(value); rest > 1;)
+    {
+        uint32_t factor = smallestPrimeFactor(rest);
+        factors.push_back(static_cast<int>(factor));
+        rest /= factor;
+    }
+    return factors;
+}
+
+// The factors come in ascending order, so the first one past bound settles the answer
+bool MagicalContainer::isSmooth(int value, int bound) const
+{
+    if (value == 0)
+    {
+        return false;
+    }
+    for (uint32_t rest = magnitudeOf(value); rest > 1;)
+    {
+        uint32_t factor = smallestPrimeFactor(rest);
+        if (bound < 2 || factor > static_cast<uint32_t>(bound))
+        {
+            return false;
+        }
+        rest /= factor;
+    }
+    return true;
+}
+
+// Returns the approximate number of bytes the factor cache occupies
+size_t MagicalContainer::factorCacheMemory() const
+{
+    return factorSieve.memoryUsage();
+}
+
+//*****Slots*****
+
+// Copies a slot of numberList and its payload
+void MagicalContainer::moveSlot(size_t from, size_t to)
+{
+    numberList[to] = numberList[from];
+    if (payloadsEnabled)
+    {
+        recordIds[to] = recordIds[from];
+        flagWords[to] = flagWords[from];
+    }
+}
+
+// Shrinks numberList and the payload columns to count slots
+void MagicalContainer::truncateSlots(size_t count)
+{
+    numberList.resize(count);
+    if (payloadsEnabled)
+    {
+        recordIds.resize(count);
+        flagWords.resize(count);
+    }
+}
+
+// Translates a prime's pointer into its position in numberList
+size_t MagicalContainer::primePosition(size_t k) const
+{
+    return static_cast<size_t>(primeIndices[k] - numberList.data());
+}
+
+//*****Search index*****
+
+// Turns the Eytzinger read index on or off
+void MagicalContainer::enableReadIndex(bool enabled)
+{
+    if (enabled)
+    {
+        requireSortedVector();
+    }
+    settle();
+    readIndexEnabled = enabled;
+    readIndexStale = enabled;
+    if (!enabled)
+    {
+        // Release the memory held by the shadow copy
+        readIndex = EytzingerIndex();
+    }
+}
+
+// Returns true if lookups go through the read index
+bool MagicalContainer::hasReadIndex() const
+{
+    return readIndexEnabled;
+}
+
+// Turns the learned index on or off
+void MagicalContainer::enableLearnedIndex(bool enabled, size_t maxError, size_t rebuildAfter)
+{
+    if (enabled)
+    {
+        requireSortedVector();
+    }
+    settle();
+    learnedIndexEnabled = enabled;
+    learnedMaxError = maxError;
+    learnedRebuildAfter = rebuildAfter;
+    // Fit the model on the next search
+    learnedIndex = LearnedIndex();
+}
+
+// Returns true if searches go through the learned index
+bool MagicalContainer::hasLearnedIndex() const
+{
+    return learnedIndexEnabled;
+}
+
+//*****Prefix sums*****
+
+// Turns the prefix-sum index on or off
+void MagicalContainer::enableSumIndex(bool enabled)
+{
+    settle();
+    if (enabled)
+    {
+        requireSortedVector();
+        // The trees are built from numberList, so the tombstones must be gone first
+        compactNow();
+    }
+    sumIndexEnabled = enabled;
+    if (enabled)
+    {
+        refreshIndices(0);
+    }
+    else
+    {
+        // Release the memory held by the trees
+        sumIndex = FenwickTree();
+        primeSumIndex = FenwickTree();
+    }
+}
+
+// Returns true if the prefix-sum index is maintained
+bool MagicalContainer::hasSumIndex() const
+{
+    return sumIndexEnabled;
+}
+
+// Returns the sum of the count smallest elements
+long long MagicalContainer::sumOfSmallest(size_t count) const
+{
+    if (count > size())
+    {
+        throw std::out_of_range("The count exceeds the number of elements.");
+    }
+    if (sumIndexEnabled)
+    {
+        // Deleted slots hold zero in the tree
+        return sumIndex.prefixSum(slotBoundary(count));
+    }
+    long long sum = 0;
+    for (size_t k = 0; k < count; ++k)
+    {
+        sum += valueAt(k);
+    }
+    return sum;
+}
+
+// Returns the sum of all elements within [low, high]
+long long MagicalContainer::sumInRange(int low, int high) const
+{
+    if (low > high)
+    {
+        return 0;
+    }
+    // The matching elements form the contiguous block [first, last) of the sorted list
+    size_t first = lowerBoundPosition(low);
+    size_t last = upperBoundPosition(high);
+    if (sumIndexEnabled)
+    {
+        return sumIndex.rangeSum(slotBoundary(first), slotBoundary(last));
+    }
+    long long sum = 0;
+    for (size_t k = first; k < last; ++k)
+    {
+        sum += valueAt(k);
+    }
+    return sum;
+}
+
+// Returns the sum of the count smallest prime elements
+long long MagicalContainer::primeSumOfSmallest(size_t count) const
+{
+    if (count > primeCount())
+    {
+        throw std::out_of_range("The count exceeds the number of prime elements.");
+    }
+    if (sumIndexEnabled)
+    {
+        return primeSumIndex.prefixSum(count == primeCount() ? primeIndices.size() : primeTombstones.slotOfLive(count));
+    }
+    long long sum = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        sum += primeAt(i);
+    }
+    return sum;
+}
+
+// Returns the sum of all prime elements within [low, high]
+long long MagicalContainer::primeSumInRange(int low, int high) const
+{
+    if (low > high)
+    {
+        return 0;
+    }
+    size_t first = primesBelow(low);
+    // Every prime in range is at most high, so the block ends before the first prime above high
+    size_t last = (high == INT_MAX) ? primeCount() : primesBelow(high + 1);
+    if (sumIndexEnabled)
+    {
+        auto boundary = [this](size_t k) { return k == primeCount() ? primeIndices.size() : primeTombstones.slotOfLive(k); };
+        return primeSumIndex.rangeSum(boundary(first), boundary(last));
+    }
+    long long sum = 0;
+    for (size_t i = first; i < last; ++i)
+    {
+        sum += primeAt(i);
+    }
+    return sum;
+}
+
+//*****Order statistics*****
+
+// Returns the number of elements smaller than value
+size_t MagicalContainer::rank(int value) const
+{
+    observeWorkload();
+    return lowerBoundPosition(value);
+}
+
+// Returns the k-th smallest element (0-based)
+int MagicalContainer::select(size_t k) const
+{
+    return (*this)[k];
+}
+
+// Returns the element at quantile q, using the lower of the two neighbouring ranks
+int MagicalContainer::quantile(double q) const
+{
+    if (!(q >= 0.0 && q <= 1.0))
+    {
+        throw std::invalid_argument("The quantile must lie within [0, 1].");
+    }
+    if (size() == 0)
+    {
+        throw std::out_of_range("The container is empty.");
+    }
+    return valueAt(static_cast<size_t>(q * static_cast<double>(size() - 1)));
+}
+
+// Returns the median, averaging the two middle elements when the size is even
+double MagicalContainer::median() const
+{
+    if (size() == 0)
+    {
+        throw std::out_of_range("The container is empty.");
+    }
+    size_t middle = size() / 2;
+    if (size() % 2 == 1)
+    {
+        return valueAt(middle);
+    }
+    return (static_cast<double>(valueAt(middle - 1)) + static_cast<double>(valueAt(middle))) / 2.0;
+}
+
+// Returns the number of elements within [low, high]
+size_t MagicalContainer::countInRange(int low, int high) const
+{
+    if (low > high)
+    {
+        return 0;
+    }
+    return upperBoundPosition(high) - lowerBoundPosition(low);
+}
+
+// Returns the number of prime elements smaller than value
+size_t MagicalContainer::primeRank(int value) const
+{
+    return primesBelow(value);
+}
+
+// Returns the k-th smallest prime element (0-based)
+int MagicalContainer::primeSelect(size_t k) const
+{
+    if (k >= primeCount())
+    {
+        throw std::out_of_range("The index exceeds the valid bounds.");
+    }
+    return primeAt(k);
+}
+
+//*****Neighbour queries*****
+
+// Returns the largest element smaller than value
+int MagicalContainer::predecessor(int value) const
+{
+    size_t position = rank(value);
+    if (position == 0)
+    {
+        throw std::out_of_range("No element is smaller than the given value.");
+    }
+    return valueAt(position - 1);
+}
+
+// Returns the smallest element greater than value
+int MagicalContainer::successor(int value) const
+{
+    size_t position = upperBoundPosition(value);
+    if (position == size())
+    {
+        throw std::out_of_range("No element is greater than the given value.");
+    }
+    return valueAt(position);
+}
+
+// Returns the element closest to value
+int MagicalContainer::nearest(int value) const
+{
+    vector<int> closest = kNearest(value, 1);
+    if (closest.empty())
+    {
+        throw std::out_of_range("The container is empty.");
+    }
+    return closest.front();
 }
 
-// Adds an element to the container while maintaining sorted order.
-void MagicalContainer::addElement(int element)
+// Returns up to k elements ordered by their distance from value
+vector<int> MagicalContainer::kNearest(int value, size_t k) const
 {
-    // Find the position where the element should be inserted to maintain sorted order
-    auto it = lower_bound(numberList.begin(), numberList.end(), element);
-    
-    // Insert the element at the calculated position
-    numberList.insert(it, element);
+    return expandAround(value, rank(value), size(), k, [this](size_t i) { return valueAt(i); });
+}
 
-    // Clear the prime indices
-    primeIndices.clear();
-    
-    // Rebuild the primeIndices vector
-    for (size_t i = 0; i < numberList.size(); ++i)
+// Returns the largest prime element smaller than value
+int MagicalContainer::primePredecessor(int value) const
+{
+    size_t position = primesBelow(value);
+    if (position == 0)
     {
-        // If the number at the current index is prime, add it to primeIndices
-        if (isPrime(numberList[i]))
-        {
-            primeIndices.push_back(&numberList[i]);
-        }
+        throw std::out_of_range("No prime element is smaller than the given value.");
     }
+    return primeAt(position - 1);
 }
 
-// Removes an element from the container, if it exists.
-void MagicalContainer::removeElement(int element)
+// Returns the smallest prime element greater than value
+int MagicalContainer::primeSuccessor(int value) const
 {
-    // Find the position of the element in the container
-    auto flag = lower_bound(numberList.begin(), numberList.end(), element);
-    
-    // If the element is found, erase it
-    if (flag != numberList.end() && *flag == element)
+    size_t position = (value == INT_MAX) ? primeCount() : primesBelow(value + 1);
+    if (position == primeCount())
     {
-        numberList.erase(flag);
+        throw std::out_of_range("No prime element is greater than the given value.");
     }
-    else
+    return primeAt(position);
+}
+
+// Returns the prime element closest to value
+int MagicalContainer::nearestPrime(int value) const
+{
+    vector<int> closest = kNearestPrimes(value, 1);
+    if (closest.empty())
     {
-        // Throw an exception if the element does not exist in the container
-        throw std::runtime_error("The element could not be located within the magicContainer.");
+        throw std::out_of_range("The container holds no prime elements.");
     }
+    return closest.front();
+}
 
-    // Clear the primeIndices
-    primeIndices.clear();
-    
-    // Rebuild the primeIndices vector after erasing an element
-    for (size_t i = 0; i < numberList.size(); ++i)
+// Returns up to k prime elements ordered by their distance from value
+vector<int> MagicalContainer::kNearestPrimes(int value, size_t k) const
+{
+    return expandAround(value, primesBelow(value), primeCount(), k, [this](size_t i) { return primeAt(i); });
+}
+
+//*****Membership*****
+
+// Returns true if value is stored in the container
+bool MagicalContainer::contains(int value) const
+{
+    observeWorkload();
+    if (membershipFilterEnabled && !membershipFilter.mayContain(value))
     {
-        if (isPrime(numberList[i]))
-        {
-            primeIndices.push_back(&numberList[i]);
-        }
+        return false;
     }
+    size_t position = lowerBoundPosition(value);
+    return position < size() && valueAt(position) == value;
 }
 
-// Returns the size of the container
-size_t MagicalContainer::size() const
+// Returns the number of copies of value in the container
+size_t MagicalContainer::count(int value) const
 {
-    return numberList.size();
+    observeWorkload();
+    if (membershipFilterEnabled && !membershipFilter.mayContain(value))
+    {
+        return 0;
+    }
+    return upperBoundPosition(value) - lowerBoundPosition(value);
 }
 
-// Returns the element at the given index
-int MagicalContainer::operator[](size_t index) const
+// Writes rank(keys[i]) into out[i] for a whole batch of keys
+void MagicalContainer::rankBatch(span<const int> keys, span<size_t> out) const
 {
-    // If the index is out of range, throw an exception
-    if (index >= numberList.size())
+    settle();
+    if (out.size() != keys.size())
     {
-        throw std::out_of_range("The index exceeds the valid bounds.");
+        throw std::invalid_argument("The output span must match the number of keys.");
+    }
+    if (store)
+    {
+        transform(keys.begin(), keys.end(), out.begin(), [this](int key) { return store->rank(key); });
+        return;
+    }
+    // A merge-join costs O(n + m log m) against O(m log n) for independent searches
+    size_t depth = static_cast<size_t>(bit_width(numberList.size()));
+    if (keys.size() * depth >= numberList.size())
+    {
+        mergeLowerBound(numberList.data(), numberList.size(), keys, out);
+    }
+    else
+    {
+        interleavedLowerBound(numberList.data(), numberList.size(), keys, out);
+    }
+    if (tombstones.deadCount() > 0)
+    {
+        for (size_t &position : out)
+        {
+            position = tombstones.liveBefore(position);
+        }
     }
-    return numberList[index];
 }
 
-// Returns all the elements of the container in a vector
-vector<int> MagicalContainer::getElements() const
+// Writes contains(keys[i]) into out[i] for a whole batch of keys
+void MagicalContainer::containsBatch(span<const int> keys, span<bool> out) const
 {
-    return numberList;
+    if (out.size() != keys.size())
+    {
+        throw std::invalid_argument("The output span must match the number of keys.");
+    }
+    vector<size_t> positions(keys.size());
+    rankBatch(keys, positions);
+    for (size_t i = 0; i < keys.size(); ++i)
+    {
+        out[i] = positions[i] < size() && valueAt(positions[i]) == keys[i];
+    }
 }
 
-// Checks if a number is prime
-bool MagicalContainer::isPrime(int num) const
+// Returns an AscendingIterator at the first copy of value, or the end iterator if it is missing
+MagicalContainer::AscendingIterator MagicalContainer::find(int value) const
 {
-    if (num <= 1)
-        return false;
-    for (int i = 2; i * i <= num; ++i)
+    size_t position = size();
+    if (membershipFilterEnabled && !membershipFilter.mayContain(value))
     {
-        if (num % i == 0)
-            return false;
+        return AscendingIterator(*this, position);
     }
-    return true;
+    position = rank(value);
+    if (position == size() || valueAt(position) != value)
+    {
+        position = size();
+    }
+    return AscendingIterator(*this, position);
 }
 
 //*****AscendingIterator*****
@@ -104,6 +1889,12 @@ MagicalContainer::AscendingIterator::AscendingIterator(const MagicalContainer &m
 {
 }
 
+// AscendingIterator constructor, starting at a specific position
+MagicalContainer::AscendingIterator::AscendingIterator(const MagicalContainer &magicContainer, size_t pos)
+    : magicContainer(magicContainer), currentPosition(pos)
+{
+}
+
 // AscendingIterator copy constructor
 MagicalContainer::AscendingIterator::AscendingIterator(const AscendingIterator &other)
     : magicContainer(other.magicContainer), currentPosition(other.currentPosition)
@@ -182,6 +1973,18 @@ int MagicalContainer::AscendingIterator::operator*() const
     return magicContainer[currentPosition];
 }
 
+// Returns the record ID of the current element
+uint64_t MagicalContainer::AscendingIterator::recordId() const
+{
+    return magicContainer.recordIdAt(currentPosition);
+}
+
+// Returns the flags word of the current element
+uint32_t MagicalContainer::AscendingIterator::flags() const
+{
+    return magicContainer.flagsAt(currentPosition);
+}
+
 // Pre-increment operator overload for AscendingIterator
 MagicalContainer::AscendingIterator &MagicalContainer::AscendingIterator::operator++()
 {
@@ -280,19 +2083,41 @@ bool MagicalContainer::PrimeIterator::operator<(const PrimeIterator &other) cons
 int MagicalContainer::PrimeIterator::operator*() const
 {
     // If the current position is out of range, throw an exception
-    if (currentPosition >= magicContainer.primeIndices.size())
+    if (currentPosition >= magicContainer.primeCount())
     {
         throw std::out_of_range("The index exceeds the valid bounds.");
     }
     // Return the value pointed by the iterator
-    return *magicContainer.primeIndices[currentPosition];
+    return magicContainer.primeAt(currentPosition);
+}
+
+// Returns the record ID of the current prime, found through its position among all the elements
+uint64_t MagicalContainer::PrimeIterator::recordId() const
+{
+    magicContainer.requirePayloads();
+    if (currentPosition >= magicContainer.primeCount())
+    {
+        throw std::out_of_range("The index exceeds the valid bounds.");
+    }
+    return magicContainer.recordIds[magicContainer.primePosition(currentPosition)];
+}
+
+// Returns the flags word of the current prime
+uint32_t MagicalContainer::PrimeIterator::flags() const
+{
+    magicContainer.requirePayloads();
+    if (currentPosition >= magicContainer.primeCount())
+    {
+        throw std::out_of_range("The index exceeds the valid bounds.");
+    }
+    return magicContainer.flagWords[magicContainer.primePosition(currentPosition)];
 }
 
 // Pre-increment operator for PrimeIterator
 MagicalContainer::PrimeIterator &MagicalContainer::PrimeIterator::operator++()
 {
     // If the current position is beyond the end, throw an exception
-    if (currentPosition >= magicContainer.primeIndices.size())
+    if (currentPosition >= magicContainer.primeCount())
     {
         throw std::runtime_error("The iterator has advanced past the endpoint.");
     }
@@ -314,7 +2139,7 @@ MagicalContainer::PrimeIterator MagicalContainer::PrimeIterator::begin()
 MagicalContainer::PrimeIterator MagicalContainer::PrimeIterator::end()
 {
     PrimeIterator iter(magicContainer);
-    iter.currentPosition = magicContainer.primeIndices.size(); // One past the last element.
+    iter.currentPosition = magicContainer.primeCount(); // One past the last element.
     return iter;
 }
 
@@ -342,8 +2167,25 @@ MagicalContainer::SideCrossIterator::SideCrossIterator(MagicalContainer& Magical
 // It alternates between beginning and end, satisfying the O(1) condition.
 int MagicalContainer::SideCrossIterator::operator*() const
 {
-    size_t index = (currentPosition % 2 == 0) ? (currentPosition / 2) : (magicContainer.size() - 1 - ((currentPosition - 1) / 2));
-    return magicContainer[index];
+    return magicContainer[elementIndex()];
+}
+
+// Maps the iteration position to an index, taking from the front on even steps and from the back on odd ones
+size_t MagicalContainer::SideCrossIterator::elementIndex() const
+{
+    return (currentPosition % 2 == 0) ? (currentPosition / 2) : (magicContainer.size() - 1 - ((currentPosition - 1) / 2));
+}
+
+// Returns the record ID of the current element
+uint64_t MagicalContainer::SideCrossIterator::recordId() const
+{
+    return magicContainer.recordIdAt(elementIndex());
+}
+
+// Returns the flags word of the current element
+uint32_t MagicalContainer::SideCrossIterator::flags() const
+{
+    return magicContainer.flagsAt(elementIndex());
 }
 
 
@@ -408,3 +2250,293 @@ MagicalContainer::SideCrossIterator MagicalContainer::SideCrossIterator::end()
 {
     return SideCrossIterator(magicContainer, magicContainer.size());
 }
+
+//*****KeyOrderIterator*****
+
+// KeyOrderIterator constructor, checking that the secondary index exists
+MagicalContainer::KeyOrderIterator::KeyOrderIterator(const MagicalContainer &magicContainer, size_t indexId, size_t pos)
+    : magicContainer(magicContainer), indexId(indexId), currentPosition(pos)
+{
+    if (indexId >= magicContainer.secondaryIndexCount())
+    {
+        throw std::invalid_argument("No secondary index has this id.");
+    }
+}
+
+// KeyOrderIterator copy constructor
+MagicalContainer::KeyOrderIterator::KeyOrderIterator(const KeyOrderIterator &other)
+    : magicContainer(other.magicContainer), indexId(other.indexId), currentPosition(other.currentPosition)
+{
+}
+
+// KeyOrderIterator destructor
+MagicalContainer::KeyOrderIterator::~KeyOrderIterator()
+{
+}
+
+// Assignment operator overload for KeyOrderIterator
+MagicalContainer::KeyOrderIterator &MagicalContainer::KeyOrderIterator::operator=(const KeyOrderIterator &other)
+{
+    // If the iterators point to different containers or orders, throw an exception
+    if (&magicContainer != &other.magicContainer || indexId != other.indexId)
+    {
+        throw std::runtime_error("The iterators are referencing distinct orders.");
+    }
+    currentPosition = other.currentPosition;
+    return *this;
+}
+
+// Equality operator overload for KeyOrderIterator
+bool MagicalContainer::KeyOrderIterator::operator==(const KeyOrderIterator &other) const
+{
+    return currentPosition == other.currentPosition && indexId == other.indexId &&
+           &magicContainer == &other.magicContainer;
+}
+
+// Inequality operator overload for KeyOrderIterator
+bool MagicalContainer::KeyOrderIterator::operator!=(const KeyOrderIterator &other) const
+{
+    return !(*this == other);
+}
+
+// Greater than operator overload for KeyOrderIterator
+bool MagicalContainer::KeyOrderIterator::operator>(const KeyOrderIterator &other) const
+{
+    return currentPosition > other.currentPosition;
+}
+
+// Less than operator overload for KeyOrderIterator
+bool MagicalContainer::KeyOrderIterator::operator<(const KeyOrderIterator &other) const
+{
+    return currentPosition < other.currentPosition;
+}
+
+// Dereference operator for KeyOrderIterator, reading the index entry in O(1)
+int MagicalContainer::KeyOrderIterator::operator*() const
+{
+    const SecondaryIndex &index = magicContainer.secondaryIndexes[indexId];
+    if (currentPosition >= index.size())
+    {
+        throw std::out_of_range("The index exceeds the valid bounds.");
+    }
+    return index.valueAt(currentPosition);
+}
+
+// Returns the key of the current element
+long long MagicalContainer::KeyOrderIterator::key() const
+{
+    const SecondaryIndex &index = magicContainer.secondaryIndexes[indexId];
+    if (currentPosition >= index.size())
+    {
+        throw std::out_of_range("The index exceeds the valid bounds.");
+    }
+    return index.keyAt(currentPosition);
+}
+
+// Pre-increment operator for KeyOrderIterator
+MagicalContainer::KeyOrderIterator &MagicalContainer::KeyOrderIterator::operator++()
+{
+    if (currentPosition >= magicContainer.secondaryIndexes[indexId].size())
+    {
+        throw std::runtime_error("The iterator has advanced past the endpoint.");
+    }
+    ++currentPosition;
+    return *this;
+}
+
+// Returns an iterator at the first element of the order
+MagicalContainer::KeyOrderIterator MagicalContainer::KeyOrderIterator::begin()
+{
+    return KeyOrderIterator(magicContainer, indexId, 0);
+}
+
+// Returns an iterator one past the last element of the order
+MagicalContainer::KeyOrderIterator MagicalContainer::KeyOrderIterator::end()
+{
+    return KeyOrderIterator(magicContainer, indexId, magicContainer.secondaryIndexes[indexId].size());
+}
+
+//*****FactorIterator*****
+
+// FactorIterator constructor, starting at the smallest factor of the element at index
+MagicalContainer::FactorIterator::FactorIterator(const MagicalContainer &magicContainer, size_t index)
+    : magicContainer(magicContainer), magnitude(1), rest(1), factor(0)
+{
+    if (index >= magicContainer.size())
+    {
+        throw std::out_of_range("The index exceeds the valid bounds.");
+    }
+    // Zero has no factorization, so it yields nothing like 1 and -1
+    magnitude = max(magnitudeOf(magicContainer[index]), 1U);
+    *this = begin();
+}
+
+// FactorIterator copy constructor
+MagicalContainer::FactorIterator::FactorIterator(const FactorIterator &other)
+    : magicContainer(other.magicContainer), magnitude(other.magnitude), rest(other.rest), factor(other.factor)
+{
+}
+
+// FactorIterator destructor
+MagicalContainer::FactorIterator::~FactorIterator()
+{
+}
+
+// Assignment operator overload for FactorIterator
+MagicalContainer::FactorIterator &MagicalContainer::FactorIterator::operator=(const FactorIterator &other)
+{
+    // If the iterators point to different containers, throw an exception
+    if (&magicContainer != &other.magicContainer)
+    {
+        throw std::runtime_error("The iterators are referencing distinct magicContainers.");
+    }
+    magnitude = other.magnitude;
+    rest = other.rest;
+    factor = other.factor;
+    return *this;
+}
+
+// Equality operator overload for FactorIterator
+bool MagicalContainer::FactorIterator::operator==(const FactorIterator &other) const
+{
+    return rest == other.rest && magnitude == other.magnitude && &magicContainer == &other.magicContainer;
+}
+
+// Inequality operator overload for FactorIterator
+bool MagicalContainer::FactorIterator::operator!=(const FactorIterator &other) const
+{
+    return !(*this == other);
+}
+
+// Dereference operator for FactorIterator
+int MagicalContainer::FactorIterator::operator*() const
+{
+    if (rest == 1)
+    {
+        throw std::out_of_range("The iterator is past the last factor.");
+    }
+    return static_cast<int>(factor);
+}
+
+// Pre-increment operator for FactorIterator, one division and one cache lookup per factor
+MagicalContainer::FactorIterator &MagicalContainer::FactorIterator::operator++()
+{
+    if (rest == 1)
+    {
+        throw std::runtime_error("The iterator has advanced past the endpoint.");
+    }
+    rest /= factor;
+    factor = rest > 1 ? magicContainer.smallestPrimeFactor(rest) : 0;
+    return *this;
+}
+
+// Returns an iterator at the smallest factor
+MagicalContainer::FactorIterator MagicalContainer::FactorIterator::begin()
+{
+    FactorIterator iter(*this);
+    iter.rest = magnitude;
+    iter.factor = magnitude > 1 ? magicContainer.smallestPrimeFactor(magnitude) : 0;
+    return iter;
+}
+
+// Returns an iterator past the largest factor
+MagicalContainer::FactorIterator MagicalContainer::FactorIterator::end()
+{
+    FactorIterator iter(*this);
+    iter.rest = 1;
+    iter.factor = 0;
+    return iter;
+}
+
+//*****SmoothIterator*****
+
+// SmoothIterator constructor, starting at the first smooth element
+MagicalContainer::SmoothIterator::SmoothIterator(const MagicalContainer &magicContainer, int bound)
+    : magicContainer(magicContainer), bound(bound), currentPosition(0)
+{
+    skipRough();
+}
+
+// SmoothIterator copy constructor
+MagicalContainer::SmoothIterator::SmoothIterator(const SmoothIterator &other)
+    : magicContainer(other.magicContainer), bound(other.bound), currentPosition(other.currentPosition)
+{
+}
+
+// SmoothIterator destructor
+MagicalContainer::SmoothIterator::~SmoothIterator()
+{
+}
+
+// Assignment operator overload for SmoothIterator
+MagicalContainer::SmoothIterator &MagicalContainer::SmoothIterator::operator=(const SmoothIterator &other)
+{
+    // If the iterators point to different containers or bounds, throw an exception
+    if (&magicContainer != &other.magicContainer || bound != other.bound)
+    {
+        throw std::runtime_error("The iterators are referencing distinct traversals.");
+    }
+    currentPosition = other.currentPosition;
+    return *this;
+}
+
+// Skips the elements with a prime factor above the bound, testing each through the factor cache
+void MagicalContainer::SmoothIterator::skipRough()
+{
+    while (currentPosition < magicContainer.size() && !magicContainer.isSmooth(magicContainer[currentPosition], bound))
+    {
+        ++currentPosition;
+    }
+}
+
+// Equality operator overload for SmoothIterator
+bool MagicalContainer::SmoothIterator::operator==(const SmoothIterator &other) const
+{
+    return currentPosition == other.currentPosition && bound == other.bound &&
+           &magicContainer == &other.magicContainer;
+}
+
+// Inequality operator overload for SmoothIterator
+bool MagicalContainer::SmoothIterator::operator!=(const SmoothIterator &other) const
+{
+    return !(*this == other);
+}
+
+// Dereference operator for SmoothIterator
+int MagicalContainer::SmoothIterator::operator*() const
+{
+    if (currentPosition >= magicContainer.size())
+    {
+        throw std::out_of_range("The index exceeds the valid bounds.");
+    }
+    return magicContainer[currentPosition];
+}
+
+// Pre-increment operator for SmoothIterator
+MagicalContainer::SmoothIterator &MagicalContainer::SmoothIterator::operator++()
+{
+    if (currentPosition >= magicContainer.size())
+    {
+        throw std::runtime_error("The iterator has advanced past the endpoint.");
+    }
+    ++currentPosition;
+    skipRough();
+    return *this;
+}
+
+// Returns an iterator at the first smooth element
+MagicalContainer::SmoothIterator MagicalContainer::SmoothIterator::begin()
+{
+    SmoothIterator iter(*this);
+    iter.currentPosition = 0;
+    iter.skipRough();
+    return iter;
+}
+
+// Returns an iterator past the last element
+MagicalContainer::SmoothIterator MagicalContainer::SmoothIterator::end()
+{
+    SmoothIterator iter(*this);
+    iter.currentPosition = magicContainer.size();
+    return iter;
+}
@@ -1,8 +1,20 @@
 #ifndef MAGICALCONTAINER_HPP
 #define MAGICALCONTAINER_HPP
 
+#include <cstdint>
+#include <functional>
+#include <span>
 #include <stdexcept>
+#include <unordered_set>
 #include <vector>
+#include "FactorSieve.hpp"
+#include "FenwickTree.hpp"
+#include "LearnedIndex.hpp"
+#include "MembershipFilter.hpp"
+#include "SearchIndex.hpp"
+#include "SecondaryIndex.hpp"
+#include "StorageBackend.hpp"
+#include "TombstoneSet.hpp"
 
 using namespace std;
 
@@ -10,31 +22,445 @@ namespace ariel
 {
     class MagicalContainer
     {
+    public:
+        // Layouts the elements can be kept in
+        enum class StorageLayout
+        {
+            SortedVector,// numberList and primeIndices; the indexes and write modes require it
+            LogStructured,// LsmStore: memtable plus geometrically growing sorted levels
+            RunLength,// RunLengthStore: one (value, count) run per distinct value
+            Dense,// DenseStore: presence bitmap over the range of the values, with a precomputed prime mask
+            Roaring,// RoaringStore: 2^16-value chunks in array, bitmap or run encoding
+            BlockPacked,// PackedStore: 128-value blocks bit-packed as offsets from their minimum
+            Frozen// EliasFano: immutable succinct encoding, entered through freeze()
+        };
+
     private:
-        vector<int> numberList;// The container for storing numbers
-        vector<int*> primeIndices;// Pointers to prime numbers within numberList
+        // The members marked mutable describe where the elements are stored rather than which elements
+        // the container holds: const reads merge the insert buffer into them (see settle()), and the
+        // adaptive layout migrates them (see observeWorkload()).
+        mutable vector<int> numberList;// The container for storing numbers
+        mutable vector<int*> primeIndices;// Pointers to prime numbers within numberList
+
+        bool sumIndexEnabled;// Whether the prefix-sum indexes below are maintained
+        mutable FenwickTree sumIndex;// Prefix sums over numberList positions
+        mutable FenwickTree primeSumIndex;// Prefix sums over the prime subset, in primeIndices order
+
+        bool readIndexEnabled;// Whether read-only lookups go through readIndex
+        mutable bool readIndexStale;// Whether numberList changed since readIndex was built
+        mutable EytzingerIndex readIndex;// Shadow copy of numberList in BFS order
+
+        bool learnedIndexEnabled;// Whether searches go through learnedIndex
+        size_t learnedRebuildAfter;// Mutations tolerated before learnedIndex is refitted
+        size_t learnedMaxError;// Error bound the segments are fitted to
+        mutable LearnedIndex learnedIndex;// Piecewise-linear position model of numberList
+
+        // Compacted copy of the storage, built a few slots at a time while tombstones are reclaimed
+        struct Compaction
+        {
+            size_t cursor = 0;// Slots of numberList already visited
+            size_t primeCursor = 0;// Entries of primeIndices already visited
+            vector<int> numbers;// Live elements copied so far, with their final capacity reserved
+            vector<int*> primes;// Pointers to the prime elements within numbers
+            TombstoneSet dead;// Removals of elements that were already copied
+            TombstoneSet deadPrimes;// Removals of prime elements that were already copied
+            FenwickTree sums;// Prefix sums over numbers, while the sum index is enabled
+            FenwickTree primeSums;// Prefix sums over primes, while the sum index is enabled
+        };
+
+        bool tombstonesEnabled;// Whether removals only mark their slot as deleted
+        double compactionThreshold;// Fraction of dead slots that starts a compaction
+        size_t compactionStep;// Slots a compaction visits per removal
+        mutable TombstoneSet tombstones;// Deleted slots of numberList
+        mutable TombstoneSet primeTombstones;// Deleted entries of primeIndices
+        mutable bool compacting;// Whether compaction below is in progress
+        mutable Compaction compaction;
+
+        bool insertBufferEnabled;// Whether addElement appends to pendingInserts
+        size_t insertBufferCapacity;// Pending inserts that trigger a merge
+        mutable vector<int> pendingInserts;// Unsorted inserts not yet merged into numberList
+
+        mutable StorageLayout layout;// Layout the elements are currently kept in; the adaptive layout changes it on reads
+        StorageLayout thawedLayout;// Layout thaw() returns to
+        mutable BackendHandle store;// Every element, unless the layout is SortedVector
+        mutable BackendHandle primeStore;// The prime elements, unless the layout is SortedVector
+
+        bool uniqueEnabled;// Whether addElement rejects values already present
+        bool uniqueFilterEnabled;// Whether members answers the duplicate checks
+        unordered_set<int> members;// Every stored value while the unique filter is on
+
+        bool membershipFilterEnabled;// Whether membershipFilter screens lookups and removals
+        MembershipFilter membershipFilter;// Approximate set of the stored values
+
+        // Resizes membershipFilter for the current elements and refills it.
+        void rebuildMembershipFilter();
+
+        mutable FactorSieve factorSieve;// Smallest prime factors, built by the first factor query
+
+        // Returns the smallest prime factor of n >= 2. The first call sizes factorSieve to the magnitudes of
+        // the elements, and a value past the table grows it, at least doubling, until it reaches its cap.
+        uint32_t smallestPrimeFactor(uint32_t n) const;
+
+        vector<SecondaryIndex> secondaryIndexes;// One permutation of the elements per registered key function
+
+        // Removes one entry per listed value from every secondary index.
+        void eraseFromSecondaryIndexes(const vector<int> &values);
+
+        // Satellite columns, one entry per slot of numberList, kept apart so key scans stay dense
+        bool payloadsEnabled;// Whether the columns below are maintained
+        vector<uint64_t> recordIds;// Record ID of every element
+        vector<uint32_t> flagWords;// Flags word of every element
+
+        // Copies slot from of numberList, along with its payload, into slot to.
+        void moveSlot(size_t from, size_t to);
+
+        // Keeps the first count slots of numberList and of the payload columns.
+        void truncateSlots(size_t count);
+
+        // Returns the position of the k-th prime element among all the elements.
+        size_t primePosition(size_t k) const;
+
+        // Throws if the payload columns are on.
+        void requireNoPayloads() const;
+
+        // Throw unless the payload columns are on, and for the second unless index addresses an element.
+        void requirePayloads() const;
+        void requirePayloadAt(size_t index) const;
+
+        // Operations seen since the adaptive layout last took a decision
+        struct Workload
+        {
+            size_t writes = 0;// Single-element inserts and removals
+            size_t lookups = 0;// Searches by value
+            size_t positional = 0;// Reads by position, iteration included
+            size_t scans = 0;// Passes over the whole container
+        };
+
+        bool adaptiveEnabled;// Whether the layout follows the workload
+        size_t adaptiveWindow;// Operations between two layout decisions
+        mutable Workload workload;
+        mutable bool adapting;// Set while adaptLayout runs, so that its own reads do not re-enter it
+
+        // Takes a layout decision once a window of operations has been observed. Called at the entry of
+        // the public operations only, where migrating the elements cannot invalidate any local state.
+        void observeWorkload() const;
+
+        // Prices the last window of operations under every layout and migrates when it pays off.
+        void adaptLayout() const;
+
+        // Throws unless the elements are kept in numberList for good.
+        void requireSortedVector() const;
+
+        // Throws if the container is frozen.
+        void requireThawed() const;
+
+        // Replaces the contents of store and primeStore with the given sorted elements.
+        void assignStores(const vector<int> &elements) const;
+
+        // Moves the given sorted elements into newLayout, held by newStore unless it is SortedVector.
+        // Expects the sorted-vector write modes and indexes to be off when leaving SortedVector.
+        void installLayout(StorageLayout newLayout, vector<int> &elements, BackendHandle newStore) const;
+
+        // Rebuilds primeIndices and every enabled index after changed elements were inserted or removed.
+        // Expects numberList to hold no tombstones.
+        void refreshIndices(size_t changed = 1) const;
+
+        // Returns the k-th live element, without a bounds check.
+        int valueAt(size_t k) const;
+
+        // Returns the slot of numberList holding the k-th live element, or numberList.size() past the end.
+        size_t slotBoundary(size_t k) const;
+
+        // Returns the number of live prime elements, respectively the k-th of them.
+        size_t primeCount() const;
+        int primeAt(size_t k) const;
+
+        // Starts a compaction once the dead fraction crosses the threshold and advances a running one.
+        void scheduleCompaction();
+
+        // Copies up to budget more slots into the compaction and swaps it in once it is complete.
+        void advanceCompaction(size_t budget) const;
+
+        // Reclaims every tombstone immediately; structural changes call it before shifting numberList.
+        void compactNow() const;
+
+        // Sorts the pending inserts and merges them into numberList in one linear pass. Const, like the
+        // helpers it calls, because it only moves elements between the mutable storage members.
+        void mergePendingInserts() const;
+
+        // Merges the pending inserts before a read.
+        void settle() const;
+
+        // Returns the number of elements smaller than value for a mutation, using the
+        // learned index when it is enabled and a branchless binary search otherwise.
+        size_t searchPosition(int value) const;
+
+        // Returns the number of live elements smaller than value (respectively not greater than value).
+        size_t lowerBoundPosition(int value) const;
+        size_t upperBoundPosition(int value) const;
+
+        // Returns the number of prime elements smaller than value.
+        size_t primesBelow(int value) const;
+
+        // Adds number unless unique mode rejects it, storing the payload while the columns are on.
+        bool admitElement(int number, uint64_t recordId, uint32_t flags);
+
+        // Inserts one copy of number into the storage, the membership filter and the secondary indexes,
+        // whatever the unique mode says. Throws, changing nothing, if the layout cannot hold number.
+        void insertElement(int number, uint64_t recordId = 0, uint32_t flags = 0);
+
+        // Inserts one copy of number into numberList, the insert buffer or the stores.
+        void storeElement(int number, uint64_t recordId, uint32_t flags);
+
+        // Removes one copy of number from the storage; returns false if it is missing.
+        bool eraseElement(int number);
 
     public:
         MagicalContainer();
         
         // Adds an element to the container while maintaining sorted order.
-        void addElement(int number);
+        // Returns false, leaving the container unchanged, if unique mode is on and number is present.
+        bool addElement(int number);
 
         // Removes an element from the container.
         void removeElement(int number);
 
+        // Removes an element from the container without throwing; returns false if it is missing.
+        bool tryRemoveElement(int number);
+
+        // Removes one copy of every listed value in a single compaction pass.
+        // Returns the number of values that could not be located instead of throwing.
+        size_t removeElements(span<const int> numbers);
+
+        // Removes every element satisfying pred; returns the number of removed elements.
+        size_t removeIf(const function<bool(int)> &pred);
+
+        // Removes every element within [low, high]; returns the number of removed elements.
+        size_t removeRange(int low, int high);
+
         // Returns the size of the container.
         size_t size() const;
 
         // Accesses the element at the given index in the container.
         int operator[](size_t index) const;
 
+        // Reads the element at the given index into value without throwing; returns false if out of range.
+        bool tryGet(size_t index, int &value) const;
+
         // Returns a vector containing all the elements in the container.
         vector<int> getElements() const;
 
-        // Checks if a number is prime.
+        // Turns tombstone deletion on or off. While it is on, removeElement marks the slot as deleted
+        // in O(log n) and positional access skips deleted slots through a rank structure. Once more than
+        // threshold of the slots are dead, a compaction runs in the background of later removals, visiting
+        // step slots per call. Insertions and bulk removals reclaim all tombstones first.
+        void setTombstoneMode(bool enabled, double threshold = 0.25, size_t step = 1024);
+
+        // Returns true if removals leave tombstones.
+        bool hasTombstoneMode() const;
+
+        // Turns the insert buffer on or off. While it is on, addElement appends to an unsorted side
+        // buffer that is sorted and merged into the storage once it holds capacity elements, or by the
+        // next read through an iterator, operator[], size() or any query. Reads always see the sorted view.
+        void setInsertBuffer(bool enabled, size_t capacity = 256);
+
+        // Returns true if inserts go through the buffer.
+        bool hasInsertBuffer() const;
+
+        // Turns set semantics on or off. While they are on, addElement ignores values already present.
+        // With hashFilter, a hash set of the stored values answers the check in O(1) expected time and
+        // rejects duplicates, as well as removals of missing values, before any search of the storage.
+        // Enabling drops the extra copies of duplicated values; returns the number of dropped elements.
+        size_t setUniqueMode(bool enabled, bool hashFilter = true);
+
+        // Returns true if addElement rejects duplicates.
+        bool hasUniqueMode() const;
+
+        // Turns the membership filter on or off. It is a counting Bloom filter kept next to the storage,
+        // which answers most lookups of missing values in tryRemoveElement, contains, count and find
+        // from a single cache line, before any search of the sorted storage.
+        void enableMembershipFilter(bool enabled);
+
+        // Returns true if lookups go through the membership filter.
+        bool hasMembershipFilter() const;
+
+        // Moves every element into the given layout. Leaving SortedVector turns off the tombstone
+        // mode, the insert buffer and the search and sum indexes, which only apply to numberList;
+        // the queries keep working through the layout's rank and select operations.
+        // The Dense layout starts over the range of the current elements and widens as values arrive;
+        // it throws invalid_argument if the elements span more than 2^30 values.
+        void setStorageLayout(StorageLayout newLayout);
+
+        // Returns the layout the elements are kept in.
+        StorageLayout storageLayout() const;
+
+        // Encodes the elements in an immutable Elias-Fano form of about 2 + log(U/n) bits per element,
+        // where U is the range of the values. Positional access, iteration and searches decode the values
+        // in place, and a bitvector over the positions answers the prime queries. Every mutation throws
+        // logic_error until thaw() is called.
+        void freeze();
+
+        // Decodes the elements back into the layout they were in before freeze().
+        void thaw();
+
+        // Returns true if the container is frozen.
+        bool isFrozen() const;
+
+        // Returns the approximate number of bytes the element storage occupies.
+        size_t memoryUsage() const;
+
+        // Turns the payload columns on or off. While they are on, every element carries a 64-bit record ID
+        // and a 32-bit flags word, stored in columns parallel to the sorted elements and moved in lockstep
+        // by insertions and removals; scans read the elements alone and payloads are read on demand.
+        // Elements present when enabling get zero payloads. The columns require the sorted-vector layout
+        // and cannot be combined with the tombstone mode or the insert buffer.
+        void enablePayloads(bool enabled);
+
+        // Returns true if the elements carry payloads.
+        bool hasPayloads() const;
+
+        // Adds an element carrying the given payload; throws logic_error unless the payloads are on.
+        // Returns false, leaving the container unchanged, if unique mode is on and number is present.
+        bool addElement(int number, uint64_t recordId, uint32_t flags = 0);
+
+        // Return the record ID, respectively the flags word, of the element at the given index.
+        uint64_t recordIdAt(size_t index) const;
+        uint32_t flagsAt(size_t index) const;
+
+        // Replaces the payload of the element at the given index.
+        void setPayloadAt(size_t index, uint64_t recordId, uint32_t flags);
+
+        // Registers an additional sorted order of the elements, by key(value) with ties broken by value,
+        // and returns its id for KeyOrderIterator. The index is kept up to date by every insertion and
+        // removal at the cost of one binary search and one shift each. SecondaryIndex::digitSum() and
+        // SecondaryIndex::modulo(m) provide the common keys.
+        size_t addSecondaryIndex(SecondaryIndex::KeyFunction key);
+
+        // Drops every secondary index.
+        void clearSecondaryIndexes();
+
+        // Returns the number of secondary indexes.
+        size_t secondaryIndexCount() const;
+
+        // Returns the prime factors of the absolute value of value in ascending order, with multiplicity.
+        // 0, 1 and -1 have none. Values within the smallest-prime-factor cache factor in O(number of factors).
+        vector<int> primeFactors(int value) const;
+
+        // Returns true if value is nonzero and none of its prime factors exceeds bound.
+        bool isSmooth(int value, int bound) const;
+
+        // Returns the approximate number of bytes the smallest-prime-factor cache occupies.
+        size_t factorCacheMemory() const;
+
+        // Turns the adaptive layout on or off. While it is on, the container counts its writes, lookups,
+        // positional reads and scans, and after every window operations it prices that mix under each
+        // layout, given the size, density and duplication of the values. It migrates when the saving
+        // expected over the next window outweighs moving the elements. Results and iterators are unaffected.
+        // Throws logic_error if a feature tied to the sorted vector is on, and those cannot be enabled
+        // while the layout is adaptive. Turning it off keeps the current layout.
+        void setAdaptiveLayout(bool enabled, size_t window = 4096);
+
+        // Returns true if the layout follows the workload.
+        bool hasAdaptiveLayout() const;
+
+        // Returns the number of inserts waiting in the buffer.
+        size_t pendingInsertCount() const;
+
+        // Returns the number of deleted slots not yet reclaimed.
+        size_t tombstoneCount() const;
+
+        // Checks if a number is prime, asking the process-wide PrimalityOracle.
         bool isPrime(int num) const;
 
+        // Turns the Eytzinger read index on or off. It is rebuilt lazily by the first lookup after
+        // a mutation, so it pays off for read-mostly containers; mutations keep using a branchless search.
+        void enableReadIndex(bool enabled);
+
+        // Returns true if lookups go through the read index.
+        bool hasReadIndex() const;
+
+        // Turns the learned index on or off. The segments keep every prediction within maxError
+        // positions; after rebuildAfter mutations the model is refitted by the next search.
+        void enableLearnedIndex(bool enabled, size_t maxError = 16, size_t rebuildAfter = 64);
+
+        // Returns true if searches go through the learned index.
+        bool hasLearnedIndex() const;
+
+        // Turns the Fenwick prefix-sum index on or off; the sum queries below run in
+        // O(log n) while it is on and fall back to a linear scan otherwise.
+        void enableSumIndex(bool enabled);
+
+        // Returns true if the prefix-sum index is maintained.
+        bool hasSumIndex() const;
+
+        // Returns the sum of the count smallest elements.
+        long long sumOfSmallest(size_t count) const;
+
+        // Returns the sum of all elements within [low, high].
+        long long sumInRange(int low, int high) const;
+
+        // Returns the sum of the count smallest prime elements.
+        long long primeSumOfSmallest(size_t count) const;
+
+        // Returns the sum of all prime elements within [low, high].
+        long long primeSumInRange(int low, int high) const;
+
+        // Returns the number of elements smaller than value.
+        size_t rank(int value) const;
+
+        // Returns the k-th smallest element (0-based).
+        int select(size_t k) const;
+
+        // Returns the element at quantile q in [0, 1], using the lower of the two neighbouring ranks.
+        int quantile(double q) const;
+
+        // Returns the median, averaging the two middle elements when the size is even.
+        double median() const;
+
+        // Returns the number of elements within [low, high].
+        size_t countInRange(int low, int high) const;
+
+        // Returns the number of prime elements smaller than value.
+        size_t primeRank(int value) const;
+
+        // Returns the k-th smallest prime element (0-based).
+        int primeSelect(size_t k) const;
+
+        // Returns the largest element smaller than value.
+        int predecessor(int value) const;
+
+        // Returns the smallest element greater than value.
+        int successor(int value) const;
+
+        // Returns the element closest to value, preferring the smaller one on a tie.
+        int nearest(int value) const;
+
+        // Returns up to k elements ordered by their distance from value, smaller first on ties.
+        vector<int> kNearest(int value, size_t k) const;
+
+        // Prime-only counterparts of the queries above, answered through primeIndices.
+        int primePredecessor(int value) const;
+        int primeSuccessor(int value) const;
+        int nearestPrime(int value) const;
+        vector<int> kNearestPrimes(int value, size_t k) const;
+
+        // Returns true if value is stored in the container.
+        bool contains(int value) const;
+
+        // Returns the number of copies of value in the container.
+        size_t count(int value) const;
+
+        // Writes rank(keys[i]) into out[i] for a whole batch of keys.
+        void rankBatch(span<const int> keys, span<size_t> out) const;
+
+        // Writes contains(keys[i]) into out[i] for a whole batch of keys.
+        void containsBatch(span<const int> keys, span<bool> out) const;
+
+        class AscendingIterator;
+
+        // Returns an AscendingIterator at the first copy of value, or the end iterator if it is missing.
+        AscendingIterator find(int value) const;
+
         class AscendingIterator
         {
         private:
@@ -43,6 +469,10 @@ namespace ariel
 
         public:
             AscendingIterator(const MagicalContainer &magicContainer);
+
+            // Constructor with a specified starting position
+            AscendingIterator(const MagicalContainer &magicContainer, size_t pos);
+
             AscendingIterator(const AscendingIterator &other);
             ~AscendingIterator();
 
@@ -57,6 +487,10 @@ namespace ariel
             // Dereference operator for accessing the element
             int operator*() const;
 
+            // Return the payload of the current element
+            uint64_t recordId() const;
+            uint32_t flags() const;
+
             // Increment operator for advancing the iterator
             AscendingIterator &operator++();
 
@@ -89,6 +523,10 @@ namespace ariel
             // Dereference operator for accessing the element
             int operator*() const;
 
+            // Return the payload of the current element
+            uint64_t recordId() const;
+            uint32_t flags() const;
+
             // Increment operator for advancing the iterator
             PrimeIterator &operator++();
 
@@ -105,6 +543,9 @@ namespace ariel
             MagicalContainer &magicContainer;// Reference to the MagicalContainer being iterated
             size_t currentPosition;// Current position in the iteration
 
+            // Returns the index of the current element, alternating between the two ends
+            size_t elementIndex() const;
+
         public:
             ~SideCrossIterator();
 
@@ -128,12 +569,121 @@ namespace ariel
             // Dereference operator for accessing the element
             int operator*() const;
 
+            // Return the payload of the current element
+            uint64_t recordId() const;
+            uint32_t flags() const;
+
             // Returns an iterator pointing to the beginning of the container
             SideCrossIterator begin();
 
             // Returns an iterator pointing to the end of the container
             SideCrossIterator end();
         };
+
+        class KeyOrderIterator
+        {
+        private:
+            const MagicalContainer &magicContainer;// Reference to the MagicalContainer being iterated
+            size_t indexId;// Secondary index giving the order
+            size_t currentPosition;// Current position in the iteration
+
+        public:
+            // Constructor for iterating in the order of the given secondary index, from a specified position
+            KeyOrderIterator(const MagicalContainer &magicContainer, size_t indexId, size_t pos = 0);
+            KeyOrderIterator(const KeyOrderIterator &other);
+            ~KeyOrderIterator();
+
+            KeyOrderIterator &operator=(const KeyOrderIterator &other);
+
+            // Comparison operators for iterators
+            bool operator>(const KeyOrderIterator &other) const;
+            bool operator<(const KeyOrderIterator &other) const;
+            bool operator==(const KeyOrderIterator &other) const;
+            bool operator!=(const KeyOrderIterator &other) const;
+
+            // Dereference operator for accessing the element
+            int operator*() const;
+
+            // Returns the key of the current element
+            long long key() const;
+
+            // Increment operator for advancing the iterator
+            KeyOrderIterator &operator++();
+
+            // Returns an iterator pointing to the beginning of the order
+            KeyOrderIterator begin();
+
+            // Returns an iterator pointing to the end of the order
+            KeyOrderIterator end();
+        };
+
+        class FactorIterator
+        {
+        private:
+            const MagicalContainer &magicContainer;// Reference to the MagicalContainer owning the factor cache
+            uint32_t magnitude;// Absolute value of the element being factored
+            uint32_t rest;// Part of magnitude not yet yielded, 1 at the end
+            uint32_t factor;// Current factor, the smallest prime factor of rest
+
+        public:
+            // Constructor for iterating over the prime factors of the element at the given index
+            FactorIterator(const MagicalContainer &magicContainer, size_t index);
+            FactorIterator(const FactorIterator &other);
+            ~FactorIterator();
+
+            FactorIterator &operator=(const FactorIterator &other);
+
+            // Comparison operators for iterators
+            bool operator==(const FactorIterator &other) const;
+            bool operator!=(const FactorIterator &other) const;
+
+            // Dereference operator for accessing the current factor
+            int operator*() const;
+
+            // Increment operator for advancing to the next factor
+            FactorIterator &operator++();
+
+            // Returns an iterator pointing to the smallest factor
+            FactorIterator begin();
+
+            // Returns an iterator pointing past the largest factor
+            FactorIterator end();
+        };
+
+        class SmoothIterator
+        {
+        private:
+            const MagicalContainer &magicContainer;// Reference to the MagicalContainer being iterated
+            int bound;// Largest prime factor allowed
+            size_t currentPosition;// Position of the current smooth element, or size() at the end
+
+            // Moves currentPosition forward to the first smooth element at or after it.
+            void skipRough();
+
+        public:
+            // Constructor for iterating over the elements whose prime factors are all at most bound
+            SmoothIterator(const MagicalContainer &magicContainer, int bound);
+            SmoothIterator(const SmoothIterator &other);
+            ~SmoothIterator();
+
+            SmoothIterator &operator=(const SmoothIterator &other);
+
+            // Comparison operators for iterators
+            bool operator==(const SmoothIterator &other) const;
+            bool operator!=(const SmoothIterator &other) const;
+
+            // Dereference operator for accessing the element
+            int operator*() const;
+
+            // Increment operator for advancing to the next smooth element
+            SmoothIterator &operator++();
+
+            // Returns an iterator pointing to the first smooth element
+            SmoothIterator begin();
+
+            // Returns an iterator pointing past the last element
+            SmoothIterator end();
+        };
     };
 }
 
@@ -0,0 +1,113 @@
+#include "MembershipFilter.hpp"
+#include <algorithm>
+using namespace ariel;
+using namespace std;
+
+namespace
+{
+    // Scrambles the bits of the key so that neighbouring values land in unrelated blocks
+    uint64_t mixKey(int key)
+    {
+        uint64_t h = static_cast<uint64_t>(static_cast<uint32_t>(key)) + 0x9e3779b97f4a7c15ULL;
+        h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+        return h ^ (h >> 31);
+    }
+
+    const uint64_t counterMax = 15;// Largest value of a 4-bit counter
+    const size_t keysPerBlock = 10;// About 13 counters per key, under 1% false positives with 4 probes
+}
+
+// Default constructor for MembershipFilter, creates a filter holding one block
+MembershipFilter::MembershipFilter() : blockCount(0), keyCount(0)
+{
+    reset(0);
+}
+
+// Hashes the key once: the low bits pick the block, four 7-bit fields pick the counters
+void MembershipFilter::locate(int key, size_t &block, size_t (&slots)[probes]) const
+{
+    uint64_t h = mixKey(key);
+    block = static_cast<size_t>((h >> 32) % blockCount);
+    for (size_t i = 0; i < probes; ++i)
+    {
+        slots[i] = static_cast<size_t>((h >> (7 * i)) & 127);
+    }
+}
+
+// Empties the filter and sizes it for the expected number of keys
+void MembershipFilter::reset(size_t expectedKeys)
+{
+    blockCount = max<size_t>(1, (expectedKeys + keysPerBlock - 1) / keysPerBlock);
+    counters.assign(blockCount * wordsPerBlock, 0);
+    keyCount = 0;
+}
+
+// Increments the four counters of the key, leaving saturated ones alone
+void MembershipFilter::add(int key)
+{
+    size_t block = 0;
+    size_t slots[probes];
+    locate(key, block, slots);
+    uint64_t *words = counters.data() + block * wordsPerBlock;
+    for (size_t slot : slots)
+    {
+        uint64_t &word = words[slot / 16];
+        unsigned shift = static_cast<unsigned>(slot % 16) * 4;
+        if (((word >> shift) & counterMax) != counterMax)
+        {
+            word += uint64_t{1} << shift;
+        }
+    }
+    ++keyCount;
+}
+
+// Decrements the four counters of the key; saturated counters no longer know their count and stay
+void MembershipFilter::remove(int key)
+{
+    size_t block = 0;
+    size_t slots[probes];
+    locate(key, block, slots);
+    uint64_t *words = counters.data() + block * wordsPerBlock;
+    for (size_t slot : slots)
+    {
+        uint64_t &word = words[slot / 16];
+        unsigned shift = static_cast<unsigned>(slot % 16) * 4;
+        uint64_t value = (word >> shift) & counterMax;
+        if (value != counterMax && value != 0)
+        {
+            word -= uint64_t{1} << shift;
+        }
+    }
+    keyCount -= min<size_t>(keyCount, 1);
+}
+
+// The key is absent if any of its counters is zero
+bool MembershipFilter::mayContain(int key) const
+{
+    size_t block = 0;
+    size_t slots[probes];
+    locate(key, block, slots);
+    const uint64_t *words = counters.data() + block * wordsPerBlock;
+    for (size_t slot : slots)
+    {
+        unsigned shift = static_cast<unsigned>(slot % 16) * 4;
+        if (((words[slot / 16] >> shift) & counterMax) == 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Returns true once the filter holds more keys than it was sized for
+bool MembershipFilter::overloaded() const
+{
+    return keyCount > blockCount * keysPerBlock;
+}
+
+// Returns the number of bytes the counters occupy
+size_t MembershipFilter::memoryUsage() const
+{
+    return counters.capacity() * sizeof(uint64_t);
+}
@@ -0,0 +1,52 @@
+#ifndef MEMBERSHIPFILTER_HPP
+#define MEMBERSHIPFILTER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+namespace ariel
+{
+    // Blocked counting Bloom filter over int keys. Every key maps to a single 64-byte block
+    // and sets four 4-bit counters inside it, so a query costs one cache line. Counters make
+    // removals possible; a counter that saturates stays put, which can only add false positives.
+    // mayContain never returns false for a key that was added and not removed since.
+    class MembershipFilter
+    {
+    private:
+        static const size_t wordsPerBlock = 8;// 64-bit words per 64-byte block, 16 counters each
+        static const size_t probes = 4;// Counters set per key
+
+        vector<uint64_t> counters;// Blocks of packed 4-bit counters
+        size_t blockCount;// Number of blocks
+        size_t keyCount;// Keys added and not removed since the last reset
+
+        // Returns the block of the key and the probed counter indexes inside it.
+        void locate(int key, size_t &block, size_t (&slots)[probes]) const;
+
+    public:
+        MembershipFilter();
+
+        // Empties the filter and sizes it for about expectedKeys keys at ~1% false positives.
+        void reset(size_t expectedKeys);
+
+        // Records one copy of key.
+        void add(int key);
+
+        // Forgets one copy of key; key must have been added.
+        void remove(int key);
+
+        // Returns false only if key is certainly absent.
+        bool mayContain(int key) const;
+
+        // Returns true once the filter holds more keys than it was sized for.
+        bool overloaded() const;
+
+        // Returns the number of bytes the counters occupy.
+        size_t memoryUsage() const;
+    };
+}
+
+#endif // MEMBERSHIPFILTER_HPP
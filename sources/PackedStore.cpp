@@ -0,0 +1,315 @@
+#include "PackedStore.hpp"
+#include <algorithm>
+#include <bit>
+#include <utility>
+using namespace ariel;
+using namespace std;
+
+namespace
+{
+    const size_t groupSize = 32;// Offsets packed together into width words
+    const size_t noBlock = static_cast<size_t>(-1);// cachedBlock while the cache holds nothing
+
+    // Unpacks a group of offsets of Width bits. The trip count, shifts and mask are compile-time
+    // constants, so the loop unrolls into straight-line shifts and masks the compiler can vectorize.
+    template <size_t Width>
+    void unpackGroup(const uint32_t *in, uint32_t *out)
+    {
+        if constexpr (Width == 0)
+        {
+            fill(out, out + groupSize, 0U);
+        }
+        else
+        {
+            constexpr uint32_t mask = ~0U >> (32 - Width);
+            for (size_t i = 0; i < groupSize; ++i)
+            {
+                size_t bit = i * Width;
+                size_t shift = bit % 32;
+                uint32_t offset = in[bit / 32] >> shift;
+                if (shift + Width > 32)
+                {
+                    offset |= in[bit / 32 + 1] << (32 - shift);
+                }
+                out[i] = offset & mask;
+            }
+        }
+    }
+
+    using Unpacker = void (*)(const uint32_t *, uint32_t *);
+
+    template <size_t... Widths>
+    constexpr array<Unpacker, sizeof...(Widths)> makeUnpackers(index_sequence<Widths...>)
+    {
+        return {unpackGroup<Widths>...};
+    }
+
+    // Unpacker of every width from 0 to 32 bits
+    const array<Unpacker, 33> unpackers = makeUnpackers(make_index_sequence<33>());
+
+    // Packs a group of offsets of the given width into out, which holds width zeroed words
+    void packGroup(const uint32_t *in, size_t width, uint32_t *out)
+    {
+        for (size_t i = 0; i < groupSize; ++i)
+        {
+            size_t bit = i * width;
+            size_t shift = bit % 32;
+            out[bit / 32] |= in[i] << shift;
+            if (shift + width > 32)
+            {
+                out[bit / 32 + 1] |= in[i] >> (32 - shift);
+            }
+        }
+    }
+}
+
+// Default constructor for PackedStore, creates an empty store
+PackedStore::PackedStore() : total(0), cachedBlock(noBlock), cachedStart(0), cache{}
+{
+}
+
+// Returns a deep copy of the store
+unique_ptr<StorageBackend> PackedStore::clone() const
+{
+    return make_unique<PackedStore>(*this);
+}
+
+// Stores the offsets from the first value at the bit width of the last one
+PackedStore::Block PackedStore::encode(const int *values, size_t count)
+{
+    array<uint32_t, blockCapacity> offsets{};
+    uint32_t minimum = static_cast<uint32_t>(values[0]);
+    for (size_t i = 0; i < count; ++i)
+    {
+        offsets[i] = static_cast<uint32_t>(values[i]) - minimum;
+    }
+    Block block;
+    block.width = static_cast<uint8_t>(bit_width(offsets[count - 1]));
+    block.count = static_cast<uint8_t>(count);
+    size_t groups = (count + groupSize - 1) / groupSize;
+    block.words.assign(groups * block.width, 0);
+    for (size_t g = 0; g < groups && block.width > 0; ++g)
+    {
+        packGroup(offsets.data() + g * groupSize, block.width, block.words.data() + g * block.width);
+    }
+    return block;
+}
+
+// Unpacks the offsets group by group and adds the minimum back
+void PackedStore::decode(const Block &block, int minimum, int *out)
+{
+    array<uint32_t, blockCapacity> offsets;
+    Unpacker unpack = unpackers[block.width];
+    size_t groups = (block.count + groupSize - 1) / groupSize;
+    for (size_t g = 0; g < groups; ++g)
+    {
+        unpack(block.words.data() + g * block.width, offsets.data() + g * groupSize);
+    }
+    uint32_t base = static_cast<uint32_t>(minimum);
+    for (size_t i = 0; i < block.count; ++i)
+    {
+        out[i] = static_cast<int>(base + offsets[i]);
+    }
+}
+
+// Decodes block b into the cache on a miss
+void PackedStore::load(size_t b, size_t start) const
+{
+    if (cachedBlock != b)
+    {
+        decode(blocks[b], minima[b], cache.data());
+        cachedBlock = b;
+    }
+    cachedStart = start;
+}
+
+// Encodes the values into block b, or into b and a new block after it once they overflow
+bool PackedStore::store(size_t b, const vector<int> &values)
+{
+    cachedBlock = noBlock;
+    if (values.size() <= blockCapacity)
+    {
+        blocks[b] = encode(values.data(), values.size());
+        minima[b] = values.front();
+        return false;
+    }
+    size_t half = values.size() / 2;
+    blocks[b] = encode(values.data(), half);
+    minima[b] = values.front();
+    auto offset = static_cast<ptrdiff_t>(b + 1);
+    blocks.insert(blocks.begin() + offset, encode(values.data() + half, values.size() - half));
+    minima.insert(minima.begin() + offset, values[half]);
+    return true;
+}
+
+// Finds the last block whose minimum is smaller than value, or the first block
+size_t PackedStore::blockBefore(int value) const
+{
+    auto it = lower_bound(minima.begin(), minima.end(), value);
+    return it == minima.begin() ? 0 : static_cast<size_t>(it - minima.begin()) - 1;
+}
+
+// Rebuilds the Fenwick tree over the block sizes
+void PackedStore::rebuildTotals()
+{
+    vector<long long> counts;
+    counts.reserve(blocks.size());
+    for (const Block &block : blocks)
+    {
+        counts.push_back(block.count);
+    }
+    blockTotals.assign(counts);
+    cachedBlock = noBlock;
+}
+
+// Cuts the sorted values into full blocks
+void PackedStore::assign(const vector<int> &sorted)
+{
+    minima.clear();
+    blocks.clear();
+    for (size_t first = 0; first < sorted.size(); first += blockCapacity)
+    {
+        minima.push_back(sorted[first]);
+        blocks.push_back(encode(sorted.data() + first, min(blockCapacity, sorted.size() - first)));
+    }
+    minima.shrink_to_fit();
+    blocks.shrink_to_fit();
+    total = sorted.size();
+    rebuildTotals();
+}
+
+// Decodes the block value falls into, inserts it and re-encodes, splitting a full block in two
+void PackedStore::insert(int value)
+{
+    ++total;
+    if (blocks.empty())
+    {
+        minima.push_back(value);
+        blocks.push_back(encode(&value, 1));
+        rebuildTotals();
+        return;
+    }
+    size_t b = blockBefore(value);
+    load(b, static_cast<size_t>(blockTotals.prefixSum(b)));
+    vector<int> values(cache.begin(), cache.begin() + blocks[b].count);
+    values.insert(upper_bound(values.begin(), values.end(), value), value);
+    if (store(b, values))
+    {
+        rebuildTotals();
+    }
+    else
+    {
+        blockTotals.add(b, 1);
+    }
+}
+
+// Removes one copy of value from its block, merging the block into its successor once it runs low
+bool PackedStore::erase(int value)
+{
+    if (blocks.empty())
+    {
+        return false;
+    }
+    // Copies of value can only sit in the block before it or, when it is a minimum, in the next one
+    size_t b = blockBefore(value);
+    for (size_t last = min(b + 2, blocks.size()); b < last; ++b)
+    {
+        load(b, static_cast<size_t>(blockTotals.prefixSum(b)));
+        vector<int> values(cache.begin(), cache.begin() + blocks[b].count);
+        auto it = lower_bound(values.begin(), values.end(), value);
+        if (it == values.end() || *it != value)
+        {
+            continue;
+        }
+        values.erase(it);
+        --total;
+        auto offset = static_cast<ptrdiff_t>(b);
+        if (b + 1 < blocks.size() && values.size() + blocks[b + 1].count <= blockCapacity / 2)
+        {
+            // Fold the small block into its successor
+            size_t kept = values.size();
+            values.resize(kept + blocks[b + 1].count);
+            decode(blocks[b + 1], minima[b + 1], values.data() + kept);
+            blocks.erase(blocks.begin() + offset + 1);
+            minima.erase(minima.begin() + offset + 1);
+            store(b, values);
+            rebuildTotals();
+        }
+        else if (values.empty())
+        {
+            blocks.erase(blocks.begin() + offset);
+            minima.erase(minima.begin() + offset);
+            rebuildTotals();
+        }
+        else
+        {
+            store(b, values);
+            blockTotals.add(b, -1);
+        }
+        return true;
+    }
+    return false;
+}
+
+// Returns the number of stored values
+size_t PackedStore::size() const
+{
+    return total;
+}
+
+// Serves a position within the cached block directly, or locates and decodes its block
+int PackedStore::select(size_t k) const
+{
+    if (cachedBlock < blocks.size() && k >= cachedStart && k - cachedStart < blocks[cachedBlock].count)
+    {
+        return cache[k - cachedStart];
+    }
+    size_t b = blockTotals.searchPrefix(static_cast<long long>(k) + 1) - 1;
+    size_t start = static_cast<size_t>(blockTotals.prefixSum(b));
+    load(b, start);
+    return cache[k - start];
+}
+
+// Counts the blocks before the one value falls into, then searches that block
+size_t PackedStore::rank(int value) const
+{
+    if (blocks.empty())
+    {
+        return 0;
+    }
+    size_t b = blockBefore(value);
+    size_t start = static_cast<size_t>(blockTotals.prefixSum(b));
+    load(b, start);
+    auto last = cache.begin() + blocks[b].count;
+    return start + static_cast<size_t>(lower_bound(cache.begin(), last, value) - cache.begin());
+}
+
+// Decodes every block straight into out
+void PackedStore::appendTo(vector<int> &out) const
+{
+    size_t first = out.size();
+    out.resize(first + total);
+    for (size_t b = 0; b < blocks.size(); ++b)
+    {
+        decode(blocks[b], minima[b], out.data() + first);
+        first += blocks[b].count;
+    }
+}
+
+// Returns the approximate number of bytes the packed blocks and the skip index occupy
+size_t PackedStore::memoryUsage() const
+{
+    size_t bytes = minima.capacity() * sizeof(int) + blocks.capacity() * sizeof(Block) +
+                   blockTotals.size() * sizeof(long long) + sizeof(cache);
+    for (const Block &block : blocks)
+    {
+        bytes += block.words.capacity() * sizeof(uint32_t);
+    }
+    return bytes;
+}
+
+// Returns the number of blocks
+size_t PackedStore::blockCount() const
+{
+    return blocks.size();
+}
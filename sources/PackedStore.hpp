@@ -0,0 +1,76 @@
+#ifndef PACKEDSTORE_HPP
+#define PACKEDSTORE_HPP
+
+#include <array>
+#include <cstdint>
+#include "FenwickTree.hpp"
+#include "StorageBackend.hpp"
+
+namespace ariel
+{
+    // Block-compressed storage: the sorted values are cut into blocks of at most 128, and every
+    // block keeps the offsets of its values from the block minimum bit-packed at the narrowest
+    // width that fits the largest one (frame of reference). The block minima form a skip index
+    // searched by value, and a Fenwick tree over the block sizes locates the block of a position.
+    // Reads decode one whole block into a cache, so sequential access decodes every block once.
+    class PackedStore : public StorageBackend
+    {
+    public:
+        static constexpr size_t blockCapacity = 128;// Values per block; four 32-value groups
+
+    private:
+        // Offsets of the values of one block, packed in groups of 32 that share width words
+        struct Block
+        {
+            uint8_t width = 0;// Bits per offset
+            uint8_t count = 0;// Number of values, up to blockCapacity
+            vector<uint32_t> words;// 32-value groups, width words each
+        };
+
+        vector<int> minima;// Smallest value of every block, the skip index
+        vector<Block> blocks;
+        FenwickTree blockTotals;// Values per block
+        size_t total;// Number of stored values
+
+        mutable size_t cachedBlock;// Block held by cache, if any
+        mutable size_t cachedStart;// Position of the first value of cachedBlock
+        mutable array<int, blockCapacity> cache;// Decoded values of cachedBlock
+
+        // Packs the given ascending values into a block, with values.front() as its minimum.
+        static Block encode(const int *values, size_t count);
+
+        // Decodes the values of a block whose minimum is given into out.
+        static void decode(const Block &block, int minimum, int *out);
+
+        // Decodes block b, which starts at position start, into cache unless it is already there.
+        void load(size_t b, size_t start) const;
+
+        // Re-encodes the given ascending values into block b, splitting them across two blocks when
+        // they exceed blockCapacity. Returns true if a block was added.
+        bool store(size_t b, const vector<int> &values);
+
+        // Returns the block a search for value starts at: the last block whose minimum is below it.
+        size_t blockBefore(int value) const;
+
+        // Rebuilds blockTotals after blocks were added or dropped.
+        void rebuildTotals();
+
+    public:
+        PackedStore();
+
+        unique_ptr<StorageBackend> clone() const override;
+        void assign(const vector<int> &sorted) override;
+        void insert(int value) override;
+        bool erase(int value) override;
+        size_t size() const override;
+        int select(size_t k) const override;
+        size_t rank(int value) const override;
+        void appendTo(vector<int> &out) const override;
+        size_t memoryUsage() const override;
+
+        // Returns the number of blocks.
+        size_t blockCount() const;
+    };
+}
+
+#endif // PACKEDSTORE_HPP
@@ -0,0 +1,365 @@
+#include "PrimalityKernel.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <stdexcept>
+#include <vector>
+using namespace ariel;
+using namespace std;
+
+namespace
+{
+    const uint32_t sieveLimit = 1U << 20;// Values below it are answered by the bitmap
+    const size_t lanes = 8;// Survivors tested together, one 256-bit register of 32-bit lanes
+    const array<uint32_t, 3> witnesses{2, 7, 61};// Deterministic Miller-Rabin bases below 2^32
+    const uint32_t segmentOdds = 1U << 18;// Odd numbers per sieve segment, 32 KiB of bits
+    const uint64_t spanPerValue = 16;// Largest window per value the segmented sieve is used for
+
+    // Odd primes of the prefilter, with their inverses modulo 2^32 and the largest quotient
+    struct Divisor
+    {
+        uint32_t inverse;// prime * inverse == 1 modulo 2^32
+        uint32_t limit;// n is a multiple of prime iff n * inverse <= limit
+    };
+
+    // Returns the inverse of the odd number n modulo 2^32, by Newton's iteration
+    uint32_t inverseModWord(uint32_t n)
+    {
+        uint32_t inverse = n;// Correct to 3 bits, every step doubles them
+        for (int i = 0; i < 4; ++i)
+        {
+            inverse *= 2 - n * inverse;
+        }
+        return inverse;
+    }
+
+    // Builds the prefilter for the odd primes up to 61
+    array<Divisor, 17> makeDivisors()
+    {
+        const array<uint32_t, 17> primes{3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53, 59, 61};
+        array<Divisor, 17> divisors{};
+        for (size_t i = 0; i < primes.size(); ++i)
+        {
+            divisors[i] = Divisor{inverseModWord(primes[i]), UINT32_MAX / primes[i]};
+        }
+        return divisors;
+    }
+
+    const array<Divisor, 17> divisors = makeDivisors();
+
+    // Bitmap over the odd numbers below sieveLimit: bit k stands for 2k + 1
+    const vector<uint64_t> &oddPrimeBits()
+    {
+        static const vector<uint64_t> bits = []
+        {
+            const uint32_t odds = sieveLimit / 2;
+            vector<uint64_t> sieve(odds / 64, ~0ULL);
+            sieve[0] &= ~1ULL;// 1 is not prime
+            for (uint32_t k = 1; (2 * k + 1) * (2 * k + 1) < sieveLimit; ++k)
+            {
+                if ((sieve[k / 64] >> (k % 64)) & 1)
+                {
+                    uint32_t step = 2 * k + 1;
+                    for (uint32_t multiple = (step * step) / 2; multiple < odds; multiple += step)
+                    {
+                        sieve[multiple / 64] &= ~(1ULL << (multiple % 64));
+                    }
+                }
+            }
+            return sieve;
+        }();
+        return bits;
+    }
+
+    // Looks a value below sieveLimit up in the bitmap; even values select 2 alone, without a branch
+    uint64_t sievedPrime(uint32_t n, const vector<uint64_t> &bits)
+    {
+        return ((bits[n / 128] >> (n / 2 % 64)) & n & 1) | static_cast<uint64_t>(n == 2);
+    }
+
+    // Returns true if n, at least sieveLimit, has an odd prime factor up to 61
+    bool hasSmallFactor(uint32_t n)
+    {
+        bool divisible = false;
+        for (const Divisor &divisor : divisors)
+        {
+            divisible |= n * divisor.inverse <= divisor.limit;
+        }
+        return divisible;
+    }
+
+    // Montgomery arithmetic modulo odd n < 2^31 with R = 2^32; the sum in reduce cannot overflow
+    struct Montgomery
+    {
+        uint32_t n;
+        uint32_t negInverse;// -n^-1 modulo 2^32
+        uint32_t one;// R modulo n
+
+        explicit Montgomery(uint32_t n) : n(n), negInverse(0U - inverseModWord(n)),
+                                          one(static_cast<uint32_t>((1ULL << 32) % n))
+        {
+        }
+
+        // Returns a * b / R modulo n
+        uint32_t multiply(uint32_t a, uint32_t b) const
+        {
+            uint64_t product = static_cast<uint64_t>(a) * b;
+            uint32_t m = static_cast<uint32_t>(product) * negInverse;
+            auto reduced = static_cast<uint32_t>((product + static_cast<uint64_t>(m) * n) >> 32);
+            return reduced >= n ? reduced - n : reduced;
+        }
+
+        // Returns a * R modulo n
+        uint32_t toForm(uint32_t a) const
+        {
+            return static_cast<uint32_t>((static_cast<uint64_t>(a) << 32) % n);
+        }
+    };
+
+    // Runs one Miller-Rabin round to the given witness on up to lanes odd candidates at once. Every lane
+    // walks the same 31 exponent bits and the same number of squarings, selecting its own result, so the
+    // loops have fixed trip counts and no per-value branches.
+    void witnessLanes(const uint32_t *candidates, size_t count, uint32_t witness, bool *passed)
+    {
+        array<Montgomery, lanes> fields{Montgomery(3), Montgomery(3), Montgomery(3), Montgomery(3),
+                                        Montgomery(3), Montgomery(3), Montgomery(3), Montgomery(3)};
+        array<uint32_t, lanes> odd{};// d in n - 1 = d * 2^s
+        array<uint32_t, lanes> twos{};// s
+        array<uint32_t, lanes> x{};
+        array<uint32_t, lanes> base{};
+        uint32_t maxTwos = 0;
+        for (size_t lane = 0; lane < lanes; ++lane)
+        {
+            // Idle lanes test 3 and are ignored
+            uint32_t n = lane < count ? candidates[lane] : 3;
+            fields[lane] = Montgomery(n);
+            twos[lane] = static_cast<uint32_t>(countr_zero(n - 1));
+            odd[lane] = (n - 1) >> twos[lane];
+            maxTwos = max(maxTwos, twos[lane]);
+            x[lane] = fields[lane].one;
+            base[lane] = fields[lane].toForm(witness % n);
+        }
+
+        // Left-to-right square and multiply over the bits of d
+        for (int bit = 30; bit >= 0; --bit)
+        {
+            for (size_t lane = 0; lane < lanes; ++lane)
+            {
+                uint32_t squared = fields[lane].multiply(x[lane], x[lane]);
+                uint32_t multiplied = fields[lane].multiply(squared, base[lane]);
+                x[lane] = ((odd[lane] >> bit) & 1) ? multiplied : squared;
+            }
+        }
+        // A lane passes if x is 1 at the start or reaches -1 within its s - 1 squarings
+        array<bool, lanes> witnessed{};
+        for (size_t lane = 0; lane < lanes; ++lane)
+        {
+            uint32_t minusOne = fields[lane].n - fields[lane].one;
+            // A witness that is a multiple of n says nothing about n
+            witnessed[lane] = base[lane] == 0 || x[lane] == fields[lane].one || x[lane] == minusOne;
+        }
+        for (uint32_t round = 1; round < maxTwos; ++round)
+        {
+            for (size_t lane = 0; lane < lanes; ++lane)
+            {
+                x[lane] = fields[lane].multiply(x[lane], x[lane]);
+                uint32_t minusOne = fields[lane].n - fields[lane].one;
+                witnessed[lane] = witnessed[lane] || (round < twos[lane] && x[lane] == minusOne);
+            }
+        }
+        copy(witnessed.begin(), witnessed.begin() + static_cast<ptrdiff_t>(count), passed);
+    }
+
+    // Runs one Miller-Rabin round to the given witness on a single odd n = odd * 2^twos + 1, with a
+    // Montgomery field built once by the caller; a lone candidate gains nothing from the lanes
+    bool passesWitness(const Montgomery &field, uint32_t odd, uint32_t twos, uint32_t witness)
+    {
+        uint32_t base = field.toForm(witness % field.n);
+        if (base == 0)
+        {
+            // A witness that is a multiple of n says nothing about n
+            return true;
+        }
+        uint32_t x = field.one;
+        for (int bit = 31 - countl_zero(odd); bit >= 0; --bit)
+        {
+            x = field.multiply(x, x);
+            if ((odd >> bit) & 1)
+            {
+                x = field.multiply(x, base);
+            }
+        }
+        uint32_t minusOne = field.n - field.one;
+        if (x == field.one || x == minusOne)
+        {
+            return true;
+        }
+        for (uint32_t round = 1; round < twos; ++round)
+        {
+            x = field.multiply(x, x);
+            if (x == minusOne)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Keeps the candidates, and their positions, that pass every witness; each round only tests the
+    // candidates the previous one let through, so most composites cost a single round
+    void millerRabin(vector<uint32_t> &candidates, vector<size_t> &positions)
+    {
+        bool passed[lanes];
+        for (uint32_t witness : witnesses)
+        {
+            size_t kept = 0;
+            for (size_t first = 0; first < candidates.size(); first += lanes)
+            {
+                size_t count = min(lanes, candidates.size() - first);
+                witnessLanes(candidates.data() + first, count, witness, passed);
+                for (size_t lane = 0; lane < count; ++lane)
+                {
+                    if (passed[lane])
+                    {
+                        candidates[kept] = candidates[first + lane];
+                        positions[kept++] = positions[first + lane];
+                    }
+                }
+            }
+            candidates.resize(kept);
+            positions.resize(kept);
+        }
+    }
+}
+
+// Classifies one value through the same stages as the batch kernel, with a scalar Miller-Rabin test
+bool ariel::isPrimeValue(int value)
+{
+    if (value < 2)
+    {
+        return false;
+    }
+    auto n = static_cast<uint32_t>(value);
+    if (n < sieveLimit)
+    {
+        return sievedPrime(n, oddPrimeBits()) != 0;
+    }
+    if (n % 2 == 0 || hasSmallFactor(n))
+    {
+        return false;
+    }
+    Montgomery field(n);
+    auto twos = static_cast<uint32_t>(countr_zero(n - 1));
+    uint32_t odd = (n - 1) >> twos;
+    for (uint32_t witness : witnesses)
+    {
+        if (!passesWitness(field, odd, twos, witness))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Settles the small values and the values with a small factor in one pass, then tests the rest in lanes
+void ariel::classifyPrimes(span<const int> values, span<uint64_t> mask)
+{
+    size_t words = (values.size() + 63) / 64;
+    if (mask.size() < words)
+    {
+        throw std::invalid_argument("The mask is too small for the values.");
+    }
+    const vector<uint64_t> &bits = oddPrimeBits();
+    vector<uint32_t> survivors;
+    vector<size_t> survivorPositions;
+    for (size_t word = 0; word < words; ++word)
+    {
+        uint64_t primes = 0;
+        size_t last = min<size_t>(64, values.size() - word * 64);
+        for (size_t bit = 0; bit < last; ++bit)
+        {
+            // Negative values wrap past sieveLimit and are rejected there
+            auto n = static_cast<uint32_t>(values[word * 64 + bit]);
+            if (n < sieveLimit)
+            {
+                primes |= sievedPrime(n, bits) << bit;
+            }
+            else if (n <= INT32_MAX && n % 2 != 0 && !hasSmallFactor(n))
+            {
+                survivors.push_back(n);
+                survivorPositions.push_back(word * 64 + bit);
+            }
+        }
+        mask[word] = primes;
+    }
+
+    millerRabin(survivors, survivorPositions);
+    for (size_t position : survivorPositions)
+    {
+        mask[position / 64] |= 1ULL << (position % 64);
+    }
+}
+
+// Sieves the window of the large values when it is dense enough, one segment at a time
+void ariel::classifySortedPrimes(span<const int> sorted, span<uint64_t> mask)
+{
+    size_t first = static_cast<size_t>(lower_bound(sorted.begin(), sorted.end(), static_cast<int>(sieveLimit)) - sorted.begin());
+    size_t large = sorted.size() - first;
+    if (large == 0 || static_cast<uint64_t>(sorted.back() - sorted[first]) >= large * spanPerValue)
+    {
+        classifyPrimes(sorted, mask);
+        return;
+    }
+    size_t words = (sorted.size() + 63) / 64;
+    if (mask.size() < words)
+    {
+        throw std::invalid_argument("The mask is too small for the values.");
+    }
+    // The small values go through the bitmap, and their last word leaves the other bits cleared
+    classifyPrimes(sorted.first(first), mask);
+    fill(mask.begin() + static_cast<ptrdiff_t>((first + 63) / 64), mask.begin() + static_cast<ptrdiff_t>(words), 0);
+
+    // Odd base primes up to the square root of the largest value, all of them within the bitmap
+    const vector<uint64_t> &bits = oddPrimeBits();
+    auto high = static_cast<uint64_t>(sorted.back());
+    vector<uint32_t> basePrimes;
+    for (uint32_t p = 3; static_cast<uint64_t>(p) * p <= high; p += 2)
+    {
+        if (sievedPrime(p, bits) != 0)
+        {
+            basePrimes.push_back(p);
+        }
+    }
+
+    // Bit j of segment stands for segmentLow + 2j
+    vector<uint64_t> segment(segmentOdds / 64);
+    for (size_t i = first; i < sorted.size();)
+    {
+        // Start at the next value, skipping the stretch of the window without any
+        uint64_t segmentLow = static_cast<uint64_t>(sorted[i]) | 1;
+        uint64_t segmentEnd = segmentLow + 2ULL * segmentOdds;
+        fill(segment.begin(), segment.end(), ~0ULL);
+        for (uint32_t p : basePrimes)
+        {
+            uint64_t multiple = max<uint64_t>(static_cast<uint64_t>(p) * p, (segmentLow + p - 1) / p * p);
+            if (multiple % 2 == 0)
+            {
+                multiple += p;
+            }
+            for (uint64_t j = (multiple - segmentLow) / 2; j < segmentOdds; j += p)
+            {
+                segment[j / 64] &= ~(1ULL << (j % 64));
+            }
+        }
+        // Read every odd value of the segment off its bit; even values, possibly below segmentLow, stay composite
+        for (; i < sorted.size() && static_cast<uint64_t>(sorted[i]) < segmentEnd; ++i)
+        {
+            auto n = static_cast<uint64_t>(sorted[i]);
+            if (n % 2 != 0)
+            {
+                uint64_t j = (n - segmentLow) / 2;
+                mask[i / 64] |= ((segment[j / 64] >> (j % 64)) & 1) << (i % 64);
+            }
+        }
+    }
+}
@@ -0,0 +1,32 @@
+#ifndef PRIMALITYKERNEL_HPP
+#define PRIMALITYKERNEL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+using namespace std;
+
+namespace ariel
+{
+    // Returns true if value is prime. Values below 2^20 are looked up in a sieve bitmap built on
+    // first use; larger ones go through a small-prime divisibility prefilter and a deterministic
+    // Miller-Rabin test to the bases 2, 7 and 61, which is exact below 4,759,123,141.
+    bool isPrimeValue(int value);
+
+    // Batch classification: bit i % 64 of mask[i / 64] is set iff values[i] is prime, and the bits
+    // past values.size() in the last word are cleared. mask must hold (values.size() + 63) / 64 words.
+    // Sieve lookups and the prefilter run over the whole batch first. The survivors then go through
+    // one Miller-Rabin witness per round, eight at a time, and only the ones that pass move on to the
+    // next witness. Every lane runs the same branch-free Montgomery exponentiation, so the inner loops
+    // carry no per-value control flow and can be vectorized.
+    void classifyPrimes(span<const int> values, span<uint64_t> mask);
+
+    // Same contract as classifyPrimes for values in ascending order. When the values past the sieve
+    // bitmap are dense enough within [their minimum, their maximum], they are classified by one
+    // segmented Sieve of Eratosthenes over that window instead, one L1-sized segment at a time, and
+    // segments holding no value are skipped. Sparse values take the per-element path.
+    void classifySortedPrimes(span<const int> sorted, span<uint64_t> mask);
+}
+
+#endif // PRIMALITYKERNEL_HPP
@@ -0,0 +1,216 @@
+#include "PrimalityOracle.hpp"
+#include "PrimalityKernel.hpp"
+#include <algorithm>
+#include <bit>
+using namespace ariel;
+using namespace std;
+
+namespace
+{
+    const uint64_t occupiedBit = 1;
+    const uint64_t primeBit = 2;
+    const uint64_t referencedBit = 4;
+    const uint32_t smallestSieve = (1U << 16) - 1;// Limit of the first bitmap
+
+    // Reads the bit of the odd-only bitmap standing for n
+    bool sieveBit(const vector<uint64_t> &oddBits, uint32_t n)
+    {
+        if (n % 2 == 0)
+        {
+            return n == 2;
+        }
+        uint32_t k = n / 2;
+        return (oddBits[k / 64] >> (k % 64)) & 1;
+    }
+}
+
+// Returns the share of memo queries answered without a Miller-Rabin test
+double PrimalityOracle::Stats::hitRate() const
+{
+    uint64_t queries = hits + misses;
+    return queries == 0 ? 0.0 : static_cast<double>(hits) / static_cast<double>(queries);
+}
+
+// Constructor for PrimalityOracle, with an empty memo split evenly across the shards and no bitmap
+// until the first query
+PrimalityOracle::PrimalityOracle(size_t capacity, uint32_t sieveCap)
+    : sieveCap(max(sieveCap, smallestSieve)), sieve(nullptr)
+{
+    size_t perShard = bit_ceil(max(capacity / shardCount, probeLimit));
+    for (Shard &shard : shards)
+    {
+        shard.slots = make_unique<atomic<uint64_t>[]>(perShard);
+        for (size_t i = 0; i < perShard; ++i)
+        {
+            shard.slots[i].store(0, memory_order_relaxed);
+        }
+        shard.slotMask = perShard - 1;
+    }
+}
+
+// The oracle is built on first use, which the language makes thread-safe
+PrimalityOracle &PrimalityOracle::shared()
+{
+    static PrimalityOracle oracle;
+    return oracle;
+}
+
+// Spreads the values over the shards by the top bits of a multiplicative hash, and over the slots by lower ones
+PrimalityOracle::Shard &PrimalityOracle::shardOf(uint32_t value, size_t &home)
+{
+    uint64_t hash = static_cast<uint64_t>(value) * 0x9E3779B97F4A7C15ULL;
+    Shard &shard = shards[hash >> 60];
+    home = static_cast<size_t>(hash >> 20) & shard.slotMask;
+    return shard;
+}
+
+// Sieves a bitmap at least twice as large as the current one and publishes it
+const PrimalityOracle::SieveLevel *PrimalityOracle::growSieve(uint32_t value)
+{
+    lock_guard<mutex> lock(growthMutex);
+    const SieveLevel *current = sieve.load(memory_order_acquire);
+    if (current != nullptr && value <= current->limit)
+    {
+        return current;
+    }
+    uint64_t wanted = max<uint64_t>(value, current == nullptr ? smallestSieve : 2ULL * current->limit + 1);
+    auto level = make_unique<SieveLevel>();
+    level->limit = static_cast<uint32_t>(min<uint64_t>(wanted, sieveCap));
+    uint32_t odds = level->limit / 2 + 1;
+    level->oddBits.assign((odds + 63) / 64, ~0ULL);
+    level->oddBits[0] &= ~1ULL;// 1 is not prime
+    for (uint32_t k = 1; static_cast<uint64_t>(2 * k + 1) * (2 * k + 1) <= level->limit; ++k)
+    {
+        if ((level->oddBits[k / 64] >> (k % 64)) & 1)
+        {
+            uint32_t step = 2 * k + 1;
+            for (uint32_t multiple = step * step / 2; multiple < odds; multiple += step)
+            {
+                level->oddBits[multiple / 64] &= ~(1ULL << (multiple % 64));
+            }
+        }
+    }
+    // Older bitmaps stay alive, since readers may still be using them; the sizes double, so they add at most as much again
+    levels.push_back(std::move(level));
+    sieve.store(levels.back().get(), memory_order_release);
+    return levels.back().get();
+}
+
+// Probes the window of the value, then tests and records it, evicting by the clock policy when the window is full
+bool PrimalityOracle::memoized(uint32_t value)
+{
+    size_t home = 0;
+    Shard &shard = shardOf(value, home);
+    for (size_t i = 0; i < probeLimit; ++i)
+    {
+        atomic<uint64_t> &slot = shard.slots[(home + i) & shard.slotMask];
+        uint64_t entry = slot.load(memory_order_acquire);
+        if (entry == 0)
+        {
+            // Slots never empty again, so the value cannot sit further along
+            break;
+        }
+        if ((entry >> 32) == value)
+        {
+            shard.hits.fetch_add(1, memory_order_relaxed);
+            if ((entry & referencedBit) == 0)
+            {
+                slot.fetch_or(referencedBit, memory_order_relaxed);
+            }
+            return (entry & primeBit) != 0;
+        }
+    }
+
+    shard.misses.fetch_add(1, memory_order_relaxed);
+    bool prime = isPrimeValue(static_cast<int>(value));
+    uint64_t fresh = (static_cast<uint64_t>(value) << 32) | (prime ? primeBit : 0) | occupiedBit;
+    for (size_t i = 0; i < probeLimit; ++i)
+    {
+        atomic<uint64_t> &slot = shard.slots[(home + i) & shard.slotMask];
+        uint64_t expected = 0;
+        if (slot.compare_exchange_strong(expected, fresh, memory_order_acq_rel))
+        {
+            shard.entries.fetch_add(1, memory_order_relaxed);
+            return prime;
+        }
+        if ((expected >> 32) == value)
+        {
+            // Another thread recorded it meanwhile
+            return prime;
+        }
+    }
+    // Second chance: take the first unreferenced slot, clearing the reference bits passed over
+    for (size_t i = 0; i < probeLimit; ++i)
+    {
+        atomic<uint64_t> &slot = shard.slots[(home + i) & shard.slotMask];
+        uint64_t entry = slot.load(memory_order_acquire);
+        if ((entry & referencedBit) == 0 && slot.compare_exchange_strong(entry, fresh, memory_order_acq_rel))
+        {
+            shard.evictions.fetch_add(1, memory_order_relaxed);
+            return prime;
+        }
+        slot.fetch_and(~referencedBit, memory_order_relaxed);
+    }
+    // Every entry was referenced and has now lost its bit; the home slot goes
+    shard.slots[home].store(fresh, memory_order_release);
+    shard.evictions.fetch_add(1, memory_order_relaxed);
+    return prime;
+}
+
+// Answers from the bitmap up to the sieve cap, and from the memo past it
+bool PrimalityOracle::isPrime(int value)
+{
+    if (value < 2)
+    {
+        return false;
+    }
+    auto n = static_cast<uint32_t>(value);
+    if (n > sieveCap)
+    {
+        return memoized(n);
+    }
+    const SieveLevel *level = sieve.load(memory_order_acquire);
+    if (level == nullptr || n > level->limit)
+    {
+        level = growSieve(n);
+    }
+    size_t home = 0;
+    shardOf(n, home).sieveAnswers.fetch_add(1, memory_order_relaxed);
+    return sieveBit(level->oddBits, n);
+}
+
+// Sums the counters of every shard
+PrimalityOracle::Stats PrimalityOracle::stats() const
+{
+    Stats result;
+    for (const Shard &shard : shards)
+    {
+        result.sieveAnswers += shard.sieveAnswers.load(memory_order_relaxed);
+        result.hits += shard.hits.load(memory_order_relaxed);
+        result.misses += shard.misses.load(memory_order_relaxed);
+        result.evictions += shard.evictions.load(memory_order_relaxed);
+        result.entries += static_cast<size_t>(shard.entries.load(memory_order_relaxed));
+        result.capacity += shard.slotMask + 1;
+    }
+    result.memoryUsage = result.capacity * sizeof(uint64_t);
+    lock_guard<mutex> lock(growthMutex);
+    const SieveLevel *level = sieve.load(memory_order_acquire);
+    result.sieveLimit = level == nullptr ? 0 : level->limit;
+    for (const unique_ptr<SieveLevel> &retained : levels)
+    {
+        result.memoryUsage += retained->oddBits.capacity() * sizeof(uint64_t);
+    }
+    return result;
+}
+
+// Zeroes the counters of every shard
+void PrimalityOracle::resetStats()
+{
+    for (Shard &shard : shards)
+    {
+        shard.sieveAnswers.store(0, memory_order_relaxed);
+        shard.hits.store(0, memory_order_relaxed);
+        shard.misses.store(0, memory_order_relaxed);
+        shard.evictions.store(0, memory_order_relaxed);
+    }
+}
@@ -0,0 +1,103 @@
+#ifndef PRIMALITYORACLE_HPP
+#define PRIMALITYORACLE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+using namespace std;
+
+namespace ariel
+{
+    // Process-wide primality answers shared by every container. Values up to sieveCap are read off
+    // an odd-only sieve bitmap that grows, at least doubling, the first time a larger value is asked
+    // about; larger values are memoized in a sharded open-addressing table after one Miller-Rabin test.
+    // Queries are lock-free: each bitmap is immutable once published, and every memo slot is a single
+    // 64-bit word updated by compare-and-swap. A value lives in one of probeLimit slots after its hash,
+    // and a full window evicts by the clock policy: hits set a reference bit, and the insertion takes
+    // the first unreferenced slot, clearing the bits it passes over, so recently used values survive.
+    class PrimalityOracle
+    {
+    public:
+        static constexpr size_t defaultCapacity = 1 << 16;// Memo slots, 512 KiB
+        static constexpr uint32_t defaultSieveCap = 1U << 24;// Largest bitmap, 1 MiB
+
+        // Counters and sizes of the oracle
+        struct Stats
+        {
+            uint64_t sieveAnswers = 0;// Queries answered by the bitmap
+            uint64_t hits = 0;// Queries answered by the memo
+            uint64_t misses = 0;// Queries that ran Miller-Rabin
+            uint64_t evictions = 0;// Memo entries replaced by the clock policy
+            size_t entries = 0;// Occupied memo slots
+            size_t capacity = 0;// Memo slots
+            uint32_t sieveLimit = 0;// Largest value the bitmap covers, 0 before the first query
+            size_t memoryUsage = 0;// Bytes held by the memo and the bitmaps
+
+            // Returns hits / (hits + misses), or 0 before the first memo query.
+            double hitRate() const;
+        };
+
+    private:
+        static constexpr size_t shardCount = 16;
+        static constexpr size_t probeLimit = 8;// Slots a value may occupy
+
+        // Odd-only bitmap over [0, limit]: bit k stands for 2k + 1
+        struct SieveLevel
+        {
+            uint32_t limit;
+            vector<uint64_t> oddBits;
+        };
+
+        // One slice of the memo with its own counters, on its own cache lines
+        struct alignas(64) Shard
+        {
+            unique_ptr<atomic<uint64_t>[]> slots;// value << 32 | referenced | prime | occupied, 0 when empty
+            size_t slotMask = 0;// Slots in the shard minus one
+            atomic<uint64_t> sieveAnswers{0};// Counted here too, by the shard of the value, to spread the writes
+            atomic<uint64_t> hits{0};
+            atomic<uint64_t> misses{0};
+            atomic<uint64_t> evictions{0};
+            atomic<uint64_t> entries{0};
+        };
+
+        uint32_t sieveCap;
+        atomic<const SieveLevel *> sieve;// Current bitmap, null before the first query
+        mutable mutex growthMutex;// Serializes the bitmap growth
+        vector<unique_ptr<SieveLevel>> levels;// Every bitmap ever published; readers may still hold older ones
+        Shard shards[shardCount];
+
+        // Returns the shard a value hashes to, and its home slot within the shard.
+        Shard &shardOf(uint32_t value, size_t &home);
+
+        // Publishes a bitmap covering value, unless a concurrent growth already did.
+        const SieveLevel *growSieve(uint32_t value);
+
+        // Looks value up in the memo, computing and recording the answer on a miss.
+        bool memoized(uint32_t value);
+
+    public:
+        // Creates an empty oracle whose memo holds about capacity slots, rounded up to a power of two per
+        // shard. The memo never resizes, so queries need no synchronization with a resize.
+        explicit PrimalityOracle(size_t capacity = defaultCapacity, uint32_t sieveCap = defaultSieveCap);
+        PrimalityOracle(const PrimalityOracle &) = delete;
+        PrimalityOracle &operator=(const PrimalityOracle &) = delete;
+
+        // Returns the oracle every container consults.
+        static PrimalityOracle &shared();
+
+        // Returns true if value is prime. Safe to call from any number of threads.
+        bool isPrime(int value);
+
+        // Returns a snapshot of the counters; concurrent queries may land on either side of it.
+        Stats stats() const;
+
+        // Zeroes the counters, keeping the memoized answers.
+        void resetStats();
+    };
+}
+
+#endif // PRIMALITYORACLE_HPP
@@ -0,0 +1,672 @@
+#include "RoaringStore.hpp"
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+using namespace ariel;
+using namespace std;
+
+namespace
+{
+    const size_t arrayLimit = 4096;// Largest array chunk; beyond it the 8 KiB bitmap is smaller
+    const size_t bitmapFloor = 2048;// A bitmap shrinking below this goes back to an array, with slack against flapping
+    const size_t bitmapBytes = 8192;// Size of a bitmap chunk
+
+    // Maps a value to an unsigned key with the same order, so the chunks follow the order of the values
+    uint32_t orderedKey(int value)
+    {
+        return static_cast<uint32_t>(value) ^ 0x80000000U;
+    }
+
+    // Inverse of orderedKey
+    int valueOfKey(uint32_t key)
+    {
+        return static_cast<int>(key ^ 0x80000000U);
+    }
+
+    // Returns the value made of the given halves
+    int joinHalves(uint16_t high, uint16_t low)
+    {
+        return valueOfKey((static_cast<uint32_t>(high) << 16) | low);
+    }
+
+    // Returns the position of the r-th set bit (0-based) of word
+    unsigned selectBit(uint64_t word, size_t r)
+    {
+        for (size_t i = 0; i < r; ++i)
+        {
+            word &= word - 1;
+        }
+        return static_cast<unsigned>(countr_zero(word));
+    }
+}
+
+//*****Chunk*****
+
+// Default constructor for Chunk, creates an empty array chunk
+RoaringStore::Chunk::Chunk() : kind(Kind::Array), cardinality(0), blockCounts{}, extraTotal(0)
+{
+}
+
+// Clears every encoding, then fills the requested one
+void RoaringStore::Chunk::encode(Kind newKind, const vector<uint16_t> &lows)
+{
+    kind = newKind;
+    cardinality = lows.size();
+    vector<uint16_t>().swap(sorted);
+    vector<uint64_t>().swap(words);
+    vector<Run>().swap(runs);
+    blockCounts.fill(0);
+    switch (kind)
+    {
+    case Kind::Array:
+        sorted = lows;
+        break;
+    case Kind::Bitmap:
+        words.assign(1024, 0);
+        for (uint16_t low : lows)
+        {
+            words[low / 64] |= uint64_t{1} << (low % 64);
+            ++blockCounts[low / 4096];
+        }
+        break;
+    case Kind::Runs:
+        for (uint16_t low : lows)
+        {
+            if (!runs.empty() && runs.back().last + 1 == low)
+            {
+                runs.back().last = low;
+            }
+            else
+            {
+                runs.push_back(Run{low, low});
+            }
+        }
+        break;
+    }
+}
+
+// Arrays grow into bitmaps, bitmaps shrink into arrays, and runs give up once they cost more than both
+void RoaringStore::Chunk::rebalance()
+{
+    Kind better = kind;
+    if (kind == Kind::Array && cardinality > arrayLimit)
+    {
+        better = Kind::Bitmap;
+    }
+    else if (kind == Kind::Bitmap && cardinality < bitmapFloor)
+    {
+        better = Kind::Array;
+    }
+    else if (kind == Kind::Runs && runs.size() * sizeof(Run) > min(cardinality * sizeof(uint16_t), bitmapBytes))
+    {
+        better = (cardinality > arrayLimit) ? Kind::Bitmap : Kind::Array;
+    }
+    if (better != kind)
+    {
+        vector<uint16_t> lows;
+        appendTo(lows);
+        encode(better, lows);
+    }
+}
+
+// Returns the encoding in use
+RoaringStore::Chunk::Kind RoaringStore::Chunk::encoding() const
+{
+    return kind;
+}
+
+// Returns the number of values in the chunk
+size_t RoaringStore::Chunk::size() const
+{
+    return cardinality;
+}
+
+// Returns true if the chunk holds low
+bool RoaringStore::Chunk::contains(uint16_t low) const
+{
+    switch (kind)
+    {
+    case Kind::Array:
+        return binary_search(sorted.begin(), sorted.end(), low);
+    case Kind::Bitmap:
+        return (words[low / 64] >> (low % 64)) & 1;
+    default:
+    {
+        auto it = upper_bound(runs.begin(), runs.end(), low, [](uint16_t key, const Run &run) { return key < run.first; });
+        return it != runs.begin() && low <= prev(it)->last;
+    }
+    }
+}
+
+// Adds low; returns false if it was already present
+bool RoaringStore::Chunk::add(uint16_t low)
+{
+    switch (kind)
+    {
+    case Kind::Array:
+    {
+        auto it = lower_bound(sorted.begin(), sorted.end(), low);
+        if (it != sorted.end() && *it == low)
+        {
+            return false;
+        }
+        sorted.insert(it, low);
+        break;
+    }
+    case Kind::Bitmap:
+    {
+        uint64_t bit = uint64_t{1} << (low % 64);
+        if (words[low / 64] & bit)
+        {
+            return false;
+        }
+        words[low / 64] |= bit;
+        ++blockCounts[low / 4096];
+        break;
+    }
+    case Kind::Runs:
+    {
+        // next is the first run starting after low
+        auto next = upper_bound(runs.begin(), runs.end(), low, [](uint16_t key, const Run &run) { return key < run.first; });
+        bool joinsPrevious = next != runs.begin() && prev(next)->last + 1 >= low;
+        if (joinsPrevious && prev(next)->last >= low)
+        {
+            return false;
+        }
+        bool joinsNext = next != runs.end() && next->first == low + 1;
+        if (joinsPrevious && joinsNext)
+        {
+            prev(next)->last = next->last;
+            runs.erase(next);
+        }
+        else if (joinsPrevious)
+        {
+            prev(next)->last = low;
+        }
+        else if (joinsNext)
+        {
+            next->first = low;
+        }
+        else
+        {
+            runs.insert(next, Run{low, low});
+        }
+        break;
+    }
+    }
+    ++cardinality;
+    rebalance();
+    return true;
+}
+
+// Removes low; returns false if it was missing
+bool RoaringStore::Chunk::remove(uint16_t low)
+{
+    switch (kind)
+    {
+    case Kind::Array:
+    {
+        auto it = lower_bound(sorted.begin(), sorted.end(), low);
+        if (it == sorted.end() || *it != low)
+        {
+            return false;
+        }
+        sorted.erase(it);
+        break;
+    }
+    case Kind::Bitmap:
+    {
+        uint64_t bit = uint64_t{1} << (low % 64);
+        if (!(words[low / 64] & bit))
+        {
+            return false;
+        }
+        words[low / 64] &= ~bit;
+        --blockCounts[low / 4096];
+        break;
+    }
+    case Kind::Runs:
+    {
+        auto next = upper_bound(runs.begin(), runs.end(), low, [](uint16_t key, const Run &run) { return key < run.first; });
+        if (next == runs.begin() || prev(next)->last < low)
+        {
+            return false;
+        }
+        auto run = prev(next);
+        if (run->first == low && run->last == low)
+        {
+            runs.erase(run);
+        }
+        else if (run->first == low)
+        {
+            ++run->first;
+        }
+        else if (run->last == low)
+        {
+            --run->last;
+        }
+        else
+        {
+            // Removing from the middle splits the run in two
+            Run tail{static_cast<uint16_t>(low + 1), run->last};
+            run->last = static_cast<uint16_t>(low - 1);
+            runs.insert(next, tail);
+        }
+        break;
+    }
+    }
+    --cardinality;
+    rebalance();
+    return true;
+}
+
+// Returns the number of values smaller than low
+size_t RoaringStore::Chunk::rank(uint16_t low) const
+{
+    switch (kind)
+    {
+    case Kind::Array:
+        return static_cast<size_t>(lower_bound(sorted.begin(), sorted.end(), low) - sorted.begin());
+    case Kind::Bitmap:
+    {
+        // Whole blocks of 64 words first, then whole words, then the bits below low
+        size_t count = 0;
+        for (size_t block = 0; block < low / 4096U; ++block)
+        {
+            count += blockCounts[block];
+        }
+        for (size_t word = low / 4096U * 64; word < low / 64U; ++word)
+        {
+            count += static_cast<size_t>(popcount(words[word]));
+        }
+        return count + static_cast<size_t>(popcount(words[low / 64] & ((uint64_t{1} << (low % 64)) - 1)));
+    }
+    default:
+    {
+        size_t count = 0;
+        for (const Run &run : runs)
+        {
+            if (run.first >= low)
+            {
+                break;
+            }
+            count += static_cast<size_t>(min(run.last + 1, static_cast<int>(low)) - run.first);
+        }
+        return count;
+    }
+    }
+}
+
+// Returns the r-th smallest value
+uint16_t RoaringStore::Chunk::select(size_t r) const
+{
+    switch (kind)
+    {
+    case Kind::Array:
+        return sorted[r];
+    case Kind::Bitmap:
+    {
+        size_t word = 0;
+        for (size_t block = 0; block < blockCounts.size(); ++block, word += 64)
+        {
+            if (r < blockCounts[block])
+            {
+                break;
+            }
+            r -= blockCounts[block];
+        }
+        for (;; ++word)
+        {
+            size_t bits = static_cast<size_t>(popcount(words[word]));
+            if (r < bits)
+            {
+                return static_cast<uint16_t>(word * 64 + selectBit(words[word], r));
+            }
+            r -= bits;
+        }
+    }
+    default:
+        for (const Run &run : runs)
+        {
+            size_t length = static_cast<size_t>(run.last - run.first) + 1;
+            if (r < length)
+            {
+                return static_cast<uint16_t>(run.first + r);
+            }
+            r -= length;
+        }
+        throw std::out_of_range("Position out of range.");
+    }
+}
+
+// Appends the values in ascending order
+void RoaringStore::Chunk::appendTo(vector<uint16_t> &out) const
+{
+    switch (kind)
+    {
+    case Kind::Array:
+        out.insert(out.end(), sorted.begin(), sorted.end());
+        break;
+    case Kind::Bitmap:
+        for (size_t word = 0; word < words.size(); ++word)
+        {
+            for (uint64_t bits = words[word]; bits != 0; bits &= bits - 1)
+            {
+                out.push_back(static_cast<uint16_t>(word * 64 + static_cast<size_t>(countr_zero(bits))));
+            }
+        }
+        break;
+    case Kind::Runs:
+        for (const Run &run : runs)
+        {
+            for (uint32_t low = run.first; low <= run.last; ++low)
+            {
+                out.push_back(static_cast<uint16_t>(low));
+            }
+        }
+        break;
+    }
+}
+
+// Counts the runs, then keeps the smallest of the three encodings
+void RoaringStore::Chunk::assign(const vector<uint16_t> &lows)
+{
+    size_t runCount = 0;
+    for (size_t i = 0; i < lows.size(); ++i)
+    {
+        runCount += (i == 0 || lows[i] != lows[i - 1] + 1) ? 1U : 0U;
+    }
+    size_t arrayCost = lows.size() * sizeof(uint16_t);
+    size_t runCost = runCount * sizeof(Run);
+    Kind best = (lows.size() > arrayLimit) ? Kind::Bitmap : Kind::Array;
+    if (runCost < min(arrayCost, bitmapBytes))
+    {
+        best = Kind::Runs;
+    }
+    encode(best, lows);
+}
+
+// Returns the approximate number of bytes the encoding occupies
+size_t RoaringStore::Chunk::memoryUsage() const
+{
+    return sizeof(Chunk) + sorted.capacity() * sizeof(uint16_t) + words.capacity() * sizeof(uint64_t) +
+           runs.capacity() * sizeof(Run) + extras.capacity() * sizeof(Extra);
+}
+
+// Recomputes the running totals of extras from the given entry on
+void RoaringStore::Chunk::sumExtras(size_t first)
+{
+    size_t copies = first == 0 ? 0 : extras[first - 1].before + extras[first - 1].copies;
+    for (size_t i = first; i < extras.size(); ++i)
+    {
+        extras[i].before = copies;
+        copies += extras[i].copies;
+    }
+}
+
+// Bumps the count of low, or inserts it; appending in ascending order costs O(1)
+void RoaringStore::Chunk::addCopy(uint16_t low)
+{
+    auto it = lower_bound(extras.begin(), extras.end(), low, [](const Extra &extra, uint16_t key) { return extra.low < key; });
+    auto position = static_cast<size_t>(it - extras.begin());
+    if (it != extras.end() && it->low == low)
+    {
+        ++it->copies;
+    }
+    else
+    {
+        extras.insert(it, Extra{low, 1, 0});
+    }
+    ++extraTotal;
+    sumExtras(position);
+}
+
+// Drops one extra copy of low, and its entry with the last one
+bool RoaringStore::Chunk::removeCopy(uint16_t low)
+{
+    auto it = lower_bound(extras.begin(), extras.end(), low, [](const Extra &extra, uint16_t key) { return extra.low < key; });
+    if (it == extras.end() || it->low != low)
+    {
+        return false;
+    }
+    auto position = static_cast<size_t>(it - extras.begin());
+    if (--it->copies == 0)
+    {
+        extras.erase(it);
+    }
+    --extraTotal;
+    sumExtras(position);
+    return true;
+}
+
+// Reads the running total of the first duplicated value not below low
+size_t RoaringStore::Chunk::copiesBelow(uint16_t low) const
+{
+    auto it = lower_bound(extras.begin(), extras.end(), low, [](const Extra &extra, uint16_t key) { return extra.low < key; });
+    return it == extras.end() ? extraTotal : it->before;
+}
+
+// Returns the number of extra copies of all values
+size_t RoaringStore::Chunk::copyCount() const
+{
+    return extraTotal;
+}
+
+// Finds the last duplicated value starting at or before r; only plain values follow it until the next one
+uint16_t RoaringStore::Chunk::selectCopy(size_t r) const
+{
+    auto firstPosition = [this](const Extra &extra) { return rank(extra.low) + extra.before; };
+    auto it = upper_bound(extras.begin(), extras.end(), r,
+                          [&firstPosition](size_t key, const Extra &extra) { return key < firstPosition(extra); });
+    if (it == extras.begin())
+    {
+        return select(r);
+    }
+    const Extra &extra = *(it - 1);
+    if (r <= firstPosition(extra) + extra.copies)
+    {
+        return extra.low;
+    }
+    return select(r - extra.before - extra.copies);
+}
+
+// Appends the values, repeating the duplicated ones
+void RoaringStore::Chunk::appendCopies(vector<uint16_t> &out) const
+{
+    size_t first = out.size();
+    appendTo(out);
+    if (extras.empty())
+    {
+        return;
+    }
+    vector<uint16_t> distinct(out.begin() + static_cast<ptrdiff_t>(first), out.end());
+    out.resize(first);
+    auto extra = extras.begin();
+    for (uint16_t low : distinct)
+    {
+        size_t copies = 1;
+        if (extra != extras.end() && extra->low == low)
+        {
+            copies += extra->copies;
+            ++extra;
+        }
+        out.insert(out.end(), copies, low);
+    }
+}
+
+//*****RoaringStore*****
+
+// Default constructor for RoaringStore, creates an empty store
+RoaringStore::RoaringStore() : total(0)
+{
+}
+
+// Returns a deep copy of the store
+unique_ptr<StorageBackend> RoaringStore::clone() const
+{
+    return make_unique<RoaringStore>(*this);
+}
+
+// Rebuilds the chunk totals from the chunk sizes and the extra copies
+void RoaringStore::rebuildTotals()
+{
+    vector<long long> totals(chunks.size());
+    for (size_t i = 0; i < chunks.size(); ++i)
+    {
+        totals[i] = static_cast<long long>(chunks[i].size() + chunks[i].copyCount());
+    }
+    chunkTotals.assign(totals);
+}
+
+// Splits the sorted values by their upper halves and lets every chunk pick its encoding
+void RoaringStore::assign(const vector<int> &sorted)
+{
+    keys.clear();
+    chunks.clear();
+    vector<uint16_t> lows;
+    for (size_t i = 0; i < sorted.size(); ++i)
+    {
+        if (i > 0 && sorted[i] == sorted[i - 1])
+        {
+            chunks.back().addCopy(static_cast<uint16_t>(orderedKey(sorted[i])));
+            continue;
+        }
+        uint32_t key = orderedKey(sorted[i]);
+        if (keys.empty() || keys.back() != key >> 16)
+        {
+            if (!keys.empty())
+            {
+                chunks.back().assign(lows);
+                lows.clear();
+            }
+            keys.push_back(static_cast<uint16_t>(key >> 16));
+            chunks.emplace_back();
+        }
+        lows.push_back(static_cast<uint16_t>(key));
+    }
+    if (!chunks.empty())
+    {
+        chunks.back().assign(lows);
+    }
+    total = sorted.size();
+    rebuildTotals();
+}
+
+// Inserts one copy of value, opening its chunk if needed
+void RoaringStore::insert(int value)
+{
+    uint32_t key = orderedKey(value);
+    uint16_t high = static_cast<uint16_t>(key >> 16);
+    auto it = lower_bound(keys.begin(), keys.end(), high);
+    size_t chunk = static_cast<size_t>(it - keys.begin());
+    bool opened = it == keys.end() || *it != high;
+    if (opened)
+    {
+        keys.insert(it, high);
+        chunks.insert(chunks.begin() + static_cast<ptrdiff_t>(chunk), Chunk());
+    }
+    if (!chunks[chunk].add(static_cast<uint16_t>(key)))
+    {
+        chunks[chunk].addCopy(static_cast<uint16_t>(key));
+    }
+    ++total;
+    if (opened)
+    {
+        rebuildTotals();
+    }
+    else
+    {
+        chunkTotals.add(chunk, 1);
+    }
+}
+
+// Removes one copy of value, closing its chunk once empty
+bool RoaringStore::erase(int value)
+{
+    uint32_t key = orderedKey(value);
+    uint16_t high = static_cast<uint16_t>(key >> 16);
+    auto it = lower_bound(keys.begin(), keys.end(), high);
+    size_t chunk = static_cast<size_t>(it - keys.begin());
+    if (it == keys.end() || *it != high)
+    {
+        return false;
+    }
+    if (!chunks[chunk].removeCopy(static_cast<uint16_t>(key)) && !chunks[chunk].remove(static_cast<uint16_t>(key)))
+    {
+        return false;
+    }
+    --total;
+    if (chunks[chunk].size() == 0)
+    {
+        keys.erase(it);
+        chunks.erase(chunks.begin() + static_cast<ptrdiff_t>(chunk));
+        rebuildTotals();
+    }
+    else
+    {
+        chunkTotals.add(chunk, -1);
+    }
+    return true;
+}
+
+// Returns the number of stored values
+size_t RoaringStore::size() const
+{
+    return total;
+}
+
+// Locates the chunk through the totals, then selects inside it
+int RoaringStore::select(size_t k) const
+{
+    size_t chunk = chunkTotals.searchPrefix(static_cast<long long>(k) + 1) - 1;
+    size_t r = k - static_cast<size_t>(chunkTotals.prefixSum(chunk));
+    return joinHalves(keys[chunk], chunks[chunk].selectCopy(r));
+}
+
+// Sums the chunks before the value's chunk, then ranks inside it
+size_t RoaringStore::rank(int value) const
+{
+    uint32_t key = orderedKey(value);
+    uint16_t high = static_cast<uint16_t>(key >> 16);
+    auto it = lower_bound(keys.begin(), keys.end(), high);
+    size_t chunk = static_cast<size_t>(it - keys.begin());
+    size_t count = static_cast<size_t>(chunkTotals.prefixSum(chunk));
+    if (it != keys.end() && *it == high)
+    {
+        uint16_t low = static_cast<uint16_t>(key);
+        count += chunks[chunk].rank(low) + chunks[chunk].copiesBelow(low);
+    }
+    return count;
+}
+
+// Appends every stored value in ascending order, chunk by chunk
+void RoaringStore::appendTo(vector<int> &out) const
+{
+    vector<uint16_t> lows;
+    for (size_t chunk = 0; chunk < chunks.size(); ++chunk)
+    {
+        lows.clear();
+        chunks[chunk].appendCopies(lows);
+        for (uint16_t low : lows)
+        {
+            out.push_back(joinHalves(keys[chunk], low));
+        }
+    }
+}
+
+// Returns the approximate number of bytes the chunks and the totals occupy
+size_t RoaringStore::memoryUsage() const
+{
+    size_t bytes = keys.capacity() * sizeof(uint16_t) + (chunkTotals.size() + 1) * sizeof(long long);
+    for (const Chunk &chunk : chunks)
+    {
+        bytes += chunk.memoryUsage();
+    }
+    return bytes;
+}
+
+// Returns the number of chunks
+size_t RoaringStore::chunkCount() const
+{
+    return chunks.size();
+}
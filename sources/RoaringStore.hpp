@@ -0,0 +1,140 @@
+#ifndef ROARINGSTORE_HPP
+#define ROARINGSTORE_HPP
+
+#include <array>
+#include <cstdint>
+#include "FenwickTree.hpp"
+#include "StorageBackend.hpp"
+
+namespace ariel
+{
+    // Roaring-style storage: the 32-bit values are split into chunks sharing their upper 16 bits,
+    // and every chunk picks the cheapest of three encodings for its lower halves: a sorted array
+    // for sparse chunks, a 2^16-bit bitmap for dense ones, or a list of runs for clustered ones.
+    // A Fenwick tree over the chunk sizes locates the chunk of a position in O(log c).
+    // The layout is built for sets: every chunk counts the extra copies of its duplicated values
+    // aside, with running totals, so positional queries stay logarithmic with duplicates too.
+    class RoaringStore : public StorageBackend
+    {
+    private:
+        // The values of one chunk, by their lower 16 bits
+        class Chunk
+        {
+        public:
+            enum class Kind
+            {
+                Array,// Sorted lower halves, 2 bytes per value
+                Bitmap,// One bit per possible lower half, 8 KiB
+                Runs// Maximal intervals of consecutive lower halves, 4 bytes per interval
+            };
+
+        private:
+            struct Run
+            {
+                uint16_t first;
+                uint16_t last;// Inclusive
+            };
+
+            // Copies beyond the first of one duplicated value
+            struct Extra
+            {
+                uint16_t low;
+                size_t copies;
+                size_t before;// Extra copies of the smaller duplicated values
+            };
+
+            Kind kind;// Encoding in use; only the matching container below is filled
+            size_t cardinality;// Number of values in the chunk
+            vector<uint16_t> sorted;// Array encoding
+            vector<uint64_t> words;// Bitmap encoding
+            array<uint16_t, 16> blockCounts;// Set bits of every 64 words of the bitmap
+            vector<Run> runs;// Run encoding
+            vector<Extra> extras;// Duplicated values, ascending
+            size_t extraTotal;// Extra copies of all the duplicated values
+
+            // Recomputes the running totals of extras from the given entry on.
+            void sumExtras(size_t first);
+
+            // Re-encodes the given ascending lower halves in the given encoding.
+            void encode(Kind newKind, const vector<uint16_t> &lows);
+
+            // Switches to the array or bitmap encoding once the current one stops paying off.
+            void rebalance();
+
+        public:
+            Chunk();
+
+            // Returns the encoding in use.
+            Kind encoding() const;
+
+            // Returns the number of values in the chunk.
+            size_t size() const;
+
+            // Returns true if the chunk holds low.
+            bool contains(uint16_t low) const;
+
+            // Adds low; returns false if it was already present.
+            bool add(uint16_t low);
+
+            // Removes low; returns false if it was missing.
+            bool remove(uint16_t low);
+
+            // Returns the number of values smaller than low.
+            size_t rank(uint16_t low) const;
+
+            // Returns the r-th smallest value (0-based).
+            uint16_t select(size_t r) const;
+
+            // Records one more copy of low, which the chunk holds already.
+            void addCopy(uint16_t low);
+
+            // Removes an extra copy of low; returns false if low has none.
+            bool removeCopy(uint16_t low);
+
+            // Returns the number of extra copies of the values smaller than low, respectively of all values.
+            size_t copiesBelow(uint16_t low) const;
+            size_t copyCount() const;
+
+            // Returns the r-th smallest value counting every copy (0-based).
+            uint16_t selectCopy(size_t r) const;
+
+            // Appends the values in ascending order, every copy included.
+            void appendCopies(vector<uint16_t> &out) const;
+
+            // Appends the values in ascending order.
+            void appendTo(vector<uint16_t> &out) const;
+
+            // Replaces the values with the given ascending ones, in the cheapest encoding.
+            void assign(const vector<uint16_t> &lows);
+
+            // Returns the approximate number of bytes the encoding occupies.
+            size_t memoryUsage() const;
+        };
+
+        vector<uint16_t> keys;// Upper halves of the chunks, ascending
+        vector<Chunk> chunks;// Chunk of every key
+        FenwickTree chunkTotals;// Stored values per chunk, extra copies included
+        size_t total;// Number of stored values
+
+        // Rebuilds chunkTotals after chunks were added or dropped.
+        void rebuildTotals();
+
+    public:
+        RoaringStore();
+
+        unique_ptr<StorageBackend> clone() const override;
+        void assign(const vector<int> &sorted) override;
+        void insert(int value) override;
+        bool erase(int value) override;
+        size_t size() const override;
+        int select(size_t k) const override;
+        size_t rank(int value) const override;
+        void appendTo(vector<int> &out) const override;
+        size_t memoryUsage() const override;
+
+        // Returns the number of chunks.
+        size_t chunkCount() const;
+    };
+}
+
+#endif // ROARINGSTORE_HPP
@@ -0,0 +1,158 @@
+#include "RunLengthStore.hpp"
+#include <algorithm>
+using namespace ariel;
+using namespace std;
+
+// Default constructor for RunLengthStore, creates an empty store
+RunLengthStore::RunLengthStore() : emptyRuns(0), total(0)
+{
+}
+
+// Returns a deep copy of the store
+unique_ptr<StorageBackend> RunLengthStore::clone() const
+{
+    return make_unique<RunLengthStore>(*this);
+}
+
+// Rebuilds the prefix sums from the counts
+void RunLengthStore::rebuildSums()
+{
+    runSums.assign(counts);
+}
+
+// Drops the empty runs once they make up half of the runs, so erase stays O(log d) amortized
+void RunLengthStore::purgeEmptyRuns()
+{
+    if (emptyRuns * 2 < values.size())
+    {
+        return;
+    }
+    size_t kept = 0;
+    for (size_t i = 0; i < values.size(); ++i)
+    {
+        if (counts[i] > 0)
+        {
+            values[kept] = values[i];
+            counts[kept] = counts[i];
+            ++kept;
+        }
+    }
+    values.resize(kept);
+    counts.resize(kept);
+    emptyRuns = 0;
+    rebuildSums();
+}
+
+// Replaces the contents with the given sorted values, one run per distinct value
+void RunLengthStore::assign(const vector<int> &sorted)
+{
+    values.clear();
+    counts.clear();
+    for (int value : sorted)
+    {
+        if (!values.empty() && values.back() == value)
+        {
+            ++counts.back();
+        }
+        else
+        {
+            values.push_back(value);
+            counts.push_back(1);
+        }
+    }
+    emptyRuns = 0;
+    total = sorted.size();
+    rebuildSums();
+}
+
+// Inserts one copy of value
+void RunLengthStore::insert(int value)
+{
+    ++total;
+    auto it = lower_bound(values.begin(), values.end(), value);
+    size_t run = static_cast<size_t>(it - values.begin());
+    if (it != values.end() && *it == value)
+    {
+        if (counts[run] == 0)
+        {
+            --emptyRuns;
+        }
+        ++counts[run];
+        runSums.add(run, 1);
+    }
+    else if (it == values.end())
+    {
+        // A new largest value extends the tree without rebuilding it
+        values.push_back(value);
+        counts.push_back(1);
+        runSums.push_back(1);
+    }
+    else
+    {
+        values.insert(it, value);
+        counts.insert(counts.begin() + static_cast<ptrdiff_t>(run), 1);
+        rebuildSums();
+    }
+}
+
+// Removes one copy of value
+bool RunLengthStore::erase(int value)
+{
+    auto it = lower_bound(values.begin(), values.end(), value);
+    size_t run = static_cast<size_t>(it - values.begin());
+    if (it == values.end() || *it != value || counts[run] == 0)
+    {
+        return false;
+    }
+    --total;
+    --counts[run];
+    runSums.add(run, -1);
+    if (counts[run] == 0)
+    {
+        ++emptyRuns;
+        purgeEmptyRuns();
+    }
+    return true;
+}
+
+// Returns the number of stored values
+size_t RunLengthStore::size() const
+{
+    return total;
+}
+
+// Returns the k-th smallest value: the run whose prefix count first exceeds k
+int RunLengthStore::select(size_t k) const
+{
+    size_t runs = runSums.searchPrefix(static_cast<long long>(k) + 1);
+    return values[runs - 1];
+}
+
+// Returns the number of stored values smaller than value
+size_t RunLengthStore::rank(int value) const
+{
+    size_t runs = static_cast<size_t>(lower_bound(values.begin(), values.end(), value) - values.begin());
+    return static_cast<size_t>(runSums.prefixSum(runs));
+}
+
+// Appends every stored value in ascending order, expanding the runs
+void RunLengthStore::appendTo(vector<int> &out) const
+{
+    for (size_t i = 0; i < values.size(); ++i)
+    {
+        out.insert(out.end(), static_cast<size_t>(counts[i]), values[i]);
+    }
+}
+
+// Returns the approximate number of bytes the runs and their prefix sums occupy
+size_t RunLengthStore::memoryUsage() const
+{
+    return values.capacity() * sizeof(int) + counts.capacity() * sizeof(long long) +
+           (runSums.size() + 1) * sizeof(long long);
+}
+
+// Returns the number of distinct values stored
+size_t RunLengthStore::runCount() const
+{
+    return values.size() - emptyRuns;
+}
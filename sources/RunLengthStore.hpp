@@ -0,0 +1,46 @@
+#ifndef RUNLENGTHSTORE_HPP
+#define RUNLENGTHSTORE_HPP
+
+#include "FenwickTree.hpp"
+#include "StorageBackend.hpp"
+
+namespace ariel
+{
+    // Run-length storage for heavily duplicated values: every distinct value is kept once
+    // with its number of copies, and a Fenwick tree over the copy counts maps positions to runs.
+    // Adding or removing a copy of a value already present is an O(log d) counter update,
+    // where d is the number of distinct values; a new distinct value shifts the runs in O(d).
+    class RunLengthStore : public StorageBackend
+    {
+    private:
+        vector<int> values;// Distinct values in ascending order
+        vector<long long> counts;// Copies of every value; runs emptied by erase stay until purged
+        FenwickTree runSums;// Prefix sums of counts
+        size_t emptyRuns;// Number of runs whose count dropped to zero
+        size_t total;// Number of stored values
+
+        // Rebuilds runSums from counts.
+        void rebuildSums();
+
+        // Drops the empty runs once they make up half of the runs.
+        void purgeEmptyRuns();
+
+    public:
+        RunLengthStore();
+
+        unique_ptr<StorageBackend> clone() const override;
+        void assign(const vector<int> &sorted) override;
+        void insert(int value) override;
+        bool erase(int value) override;
+        size_t size() const override;
+        int select(size_t k) const override;
+        size_t rank(int value) const override;
+        void appendTo(vector<int> &out) const override;
+        size_t memoryUsage() const override;
+
+        // Returns the number of distinct values stored.
+        size_t runCount() const;
+    };
+}
+
+#endif // RUNLENGTHSTORE_HPP
@@ -0,0 +1,135 @@
+#include "SearchIndex.hpp"
+#include <algorithm>
+#include <bit>
+#include <numeric>
+using namespace ariel;
+using namespace std;
+
+// Branchless binary search: the window halves every step whatever the outcome of the compare
+size_t ariel::branchlessLowerBound(const int *data, size_t count, int key)
+{
+    if (count == 0)
+    {
+        return 0;
+    }
+    const int *base = data;
+    size_t length = count;
+    while (length > 1)
+    {
+        size_t half = length / 2;
+        // Fetch the midpoints of both halves before knowing which one comes next
+        __builtin_prefetch(base + half / 2);
+        __builtin_prefetch(base + half + half / 2);
+        base = (base[half] < key) ? base + half : base;
+        length -= half;
+    }
+    return static_cast<size_t>(base - data) + (*base < key ? 1 : 0);
+}
+
+// Runs the branchless search for groups of keys level by level
+void ariel::interleavedLowerBound(const int *data, size_t count, span<const int> keys, span<size_t> out)
+{
+    const size_t groupSize = 16;// Searches in flight at once, about the number of outstanding misses a core sustains
+    const int *bases[groupSize];
+    for (size_t group = 0; group < keys.size(); group += groupSize)
+    {
+        size_t width = min(groupSize, keys.size() - group);
+        if (count == 0)
+        {
+            fill_n(out.begin() + static_cast<ptrdiff_t>(group), width, 0);
+            continue;
+        }
+        fill_n(bases, width, data);
+        // Every search has the same trip count, so the group shares a single window length
+        size_t length = count;
+        while (length > 1)
+        {
+            size_t half = length / 2;
+            for (size_t i = 0; i < width; ++i)
+            {
+                __builtin_prefetch(bases[i] + half / 2);
+                __builtin_prefetch(bases[i] + half + half / 2);
+            }
+            for (size_t i = 0; i < width; ++i)
+            {
+                bases[i] = (bases[i][half] < keys[group + i]) ? bases[i] + half : bases[i];
+            }
+            length -= half;
+        }
+        for (size_t i = 0; i < width; ++i)
+        {
+            out[group + i] = static_cast<size_t>(bases[i] - data) + (*bases[i] < keys[group + i] ? 1 : 0);
+        }
+    }
+}
+
+// Sorts the probe order, then answers every probe from one forward scan of the array
+void ariel::mergeLowerBound(const int *data, size_t count, span<const int> keys, span<size_t> out)
+{
+    vector<size_t> order(keys.size());
+    iota(order.begin(), order.end(), 0);
+    sort(order.begin(), order.end(), [&keys](size_t a, size_t b) { return keys[a] < keys[b]; });
+    size_t cursor = 0;
+    for (size_t probe : order)
+    {
+        while (cursor < count && data[cursor] < keys[probe])
+        {
+            ++cursor;
+        }
+        out[probe] = cursor;
+    }
+}
+
+//*****EytzingerIndex*****
+
+// Default constructor for EytzingerIndex, creates an empty index
+EytzingerIndex::EytzingerIndex() : layout(1, 0), sortedPosition(1, 0)
+{
+}
+
+// Visits the implicit tree in order so that consecutive sorted values land on consecutive in-order nodes
+void EytzingerIndex::place(const vector<int> &values, size_t &next, size_t node)
+{
+    if (node >= layout.size())
+    {
+        return;
+    }
+    place(values, next, 2 * node);
+    layout[node] = values[next];
+    sortedPosition[node] = next;
+    ++next;
+    place(values, next, 2 * node + 1);
+}
+
+// Rebuilds the layout from the sorted values
+void EytzingerIndex::build(const vector<int> &values)
+{
+    layout.assign(values.size() + 1, 0);
+    sortedPosition.assign(values.size() + 1, values.size());
+    size_t next = 0;
+    place(values, next, 1);
+}
+
+// Descends the tree branch-free, then strips the trailing right turns to recover the answer
+size_t EytzingerIndex::lowerBound(int key) const
+{
+    size_t node = 1;
+    while (node < layout.size())
+    {
+        // The 16 descendants four levels down share one cache line
+        if (node * 16 < layout.size())
+        {
+            __builtin_prefetch(layout.data() + node * 16);
+        }
+        node = 2 * node + (layout[node] < key ? 1 : 0);
+    }
+    // The last left turn marks the smallest value not less than key
+    node >>= countr_one(node) + 1;
+    return node == 0 ? size() : sortedPosition[node];
+}
+
+// Returns the number of indexed values
+size_t EytzingerIndex::size() const
+{
+    return layout.size() - 1;
+}
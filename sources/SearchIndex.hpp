@@ -0,0 +1,52 @@
+#ifndef SEARCHINDEX_HPP
+#define SEARCHINDEX_HPP
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+using namespace std;
+
+namespace ariel
+{
+    // Returns the number of entries in the sorted array data[0, count) that are smaller than key.
+    // The loop has a fixed trip count and no data-dependent branches, and it prefetches both
+    // possible midpoints of the next step so the cache miss overlaps with the current compare.
+    size_t branchlessLowerBound(const int *data, size_t count, int key);
+
+    // Batched branchless searches: out[i] receives the lower bound of keys[i].
+    // Groups of searches advance in lockstep, one level at a time, so the cache misses
+    // of a whole group are in flight together instead of one after another.
+    void interleavedLowerBound(const int *data, size_t count, span<const int> keys, span<size_t> out);
+
+    // Batched lower bounds by merge-join: the probes are visited in key order while a
+    // single cursor walks the array. Pays off once the batch is dense relative to count.
+    void mergeLowerBound(const int *data, size_t count, span<const int> keys, span<size_t> out);
+
+    // Read-optimized shadow copy of a sorted array stored in Eytzinger (BFS) order.
+    // The first levels of the implicit tree share cache lines, and the descendants
+    // four levels down are contiguous, so every search prefetches them one line at a time.
+    class EytzingerIndex
+    {
+    private:
+        vector<int> layout;// 1-based BFS layout of the values, layout[0] is unused
+        vector<size_t> sortedPosition;// Position in the source array of every layout slot
+
+        // Fills the layout by an in-order walk of the implicit tree rooted at node.
+        void place(const vector<int> &values, size_t &next, size_t node);
+
+    public:
+        EytzingerIndex();
+
+        // Rebuilds the layout from the sorted values in O(n).
+        void build(const vector<int> &values);
+
+        // Returns the number of indexed values smaller than key.
+        size_t lowerBound(int key) const;
+
+        // Returns the number of indexed values.
+        size_t size() const;
+    };
+}
+
+#endif // SEARCHINDEX_HPP
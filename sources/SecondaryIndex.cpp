@@ -0,0 +1,139 @@
+#include "SecondaryIndex.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+using namespace ariel;
+using namespace std;
+
+namespace
+{
+    // Orders entries by key, then by value
+    template <typename Entry>
+    bool entryBefore(const Entry &first, const Entry &second)
+    {
+        return first.key < second.key || (first.key == second.key && first.value < second.value);
+    }
+}
+
+// Sums the decimal digits, widening first so that INT_MIN has an absolute value
+SecondaryIndex::KeyFunction SecondaryIndex::digitSum()
+{
+    return [](int value)
+    {
+        long long rest = value < 0 ? -static_cast<long long>(value) : value;
+        long long sum = 0;
+        for (; rest > 0; rest /= 10)
+        {
+            sum += rest % 10;
+        }
+        return sum;
+    };
+}
+
+// Folds the remainder of negative values into [0, m)
+SecondaryIndex::KeyFunction SecondaryIndex::modulo(int m)
+{
+    if (m <= 0)
+    {
+        throw std::invalid_argument("The modulus must be positive.");
+    }
+    return [m](int value)
+    {
+        long long remainder = value % m;
+        return remainder < 0 ? remainder + m : remainder;
+    };
+}
+
+// Constructor for SecondaryIndex, creates an empty index ordered by keyOf
+SecondaryIndex::SecondaryIndex(KeyFunction keyOf) : keyOf(std::move(keyOf))
+{
+    if (!this->keyOf)
+    {
+        throw std::invalid_argument("The key function must not be empty.");
+    }
+}
+
+// Binary search over the entries in (key, value) order
+size_t SecondaryIndex::lowerBound(const Entry &entry) const
+{
+    return static_cast<size_t>(lower_bound(entries.begin(), entries.end(), entry, entryBefore<Entry>) - entries.begin());
+}
+
+// Evaluates every key once and sorts the entries
+void SecondaryIndex::build(const vector<int> &values)
+{
+    entries.clear();
+    entries.reserve(values.size());
+    for (int value : values)
+    {
+        entries.push_back(Entry{keyOf(value), value});
+    }
+    sort(entries.begin(), entries.end(), entryBefore<Entry>);
+}
+
+// Inserts the entry at its sorted position
+void SecondaryIndex::insert(int value)
+{
+    Entry entry{keyOf(value), value};
+    entries.insert(entries.begin() + static_cast<ptrdiff_t>(lowerBound(entry)), entry);
+}
+
+// Erases the first entry equal to (key, value)
+bool SecondaryIndex::erase(int value)
+{
+    Entry entry{keyOf(value), value};
+    size_t position = lowerBound(entry);
+    if (position == entries.size() || entries[position].key != entry.key || entries[position].value != value)
+    {
+        return false;
+    }
+    entries.erase(entries.begin() + static_cast<ptrdiff_t>(position));
+    return true;
+}
+
+// Sorts the victims in entry order and merges them against the entries, sliding every survivor into place
+void SecondaryIndex::eraseAll(const vector<int> &values)
+{
+    vector<Entry> victims;
+    victims.reserve(values.size());
+    for (int value : values)
+    {
+        victims.push_back(Entry{keyOf(value), value});
+    }
+    sort(victims.begin(), victims.end(), entryBefore<Entry>);
+
+    size_t victim = 0;
+    size_t write = 0;
+    for (size_t read = 0; read < entries.size(); ++read)
+    {
+        while (victim < victims.size() && entryBefore(victims[victim], entries[read]))
+        {
+            ++victim;
+        }
+        if (victim < victims.size() && !entryBefore(entries[read], victims[victim]))
+        {
+            ++victim;
+            continue;
+        }
+        entries[write++] = entries[read];
+    }
+    entries.resize(write);
+}
+
+// Returns the number of entries
+size_t SecondaryIndex::size() const
+{
+    return entries.size();
+}
+
+// Returns the value of the entry at the given position
+int SecondaryIndex::valueAt(size_t position) const
+{
+    return entries[position].value;
+}
+
+// Returns the key of the entry at the given position
+long long SecondaryIndex::keyAt(size_t position) const
+{
+    return entries[position].key;
+}
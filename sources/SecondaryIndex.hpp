@@ -0,0 +1,61 @@
+#ifndef SECONDARYINDEX_HPP
+#define SECONDARYINDEX_HPP
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+using namespace std;
+
+namespace ariel
+{
+    // Sorted permutation of a multiset of ints by a derived key, ties broken by value.
+    // The entries are kept in one sorted array, so positional reads are O(1) and a single
+    // insertion or removal costs a binary search plus one shift, like the primary storage.
+    class SecondaryIndex
+    {
+    public:
+        using KeyFunction = function<long long(int)>;
+
+        // Key functions for the common derived orders
+        static KeyFunction digitSum();// Sum of the decimal digits of the absolute value
+        static KeyFunction modulo(int m);// Non-negative remainder modulo m; m must be positive
+
+    private:
+        struct Entry
+        {
+            long long key;
+            int value;
+        };
+
+        KeyFunction keyOf;
+        vector<Entry> entries;// Sorted by key, then by value
+
+        // Returns the position of the first entry not smaller than entry.
+        size_t lowerBound(const Entry &entry) const;
+
+    public:
+        explicit SecondaryIndex(KeyFunction keyOf);
+
+        // Replaces the entries with the given values, which may come in any order.
+        void build(const vector<int> &values);
+
+        // Adds one entry for value.
+        void insert(int value);
+
+        // Removes one entry for value; returns false if it is missing.
+        bool erase(int value);
+
+        // Removes one entry for every listed value in a single pass.
+        void eraseAll(const vector<int> &values);
+
+        // Returns the number of entries.
+        size_t size() const;
+
+        // Returns the value, respectively the key, of the entry at the given position.
+        int valueAt(size_t position) const;
+        long long keyAt(size_t position) const;
+    };
+}
+
+#endif // SECONDARYINDEX_HPP
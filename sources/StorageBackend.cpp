@@ -0,0 +1,102 @@
+#include "StorageBackend.hpp"
+#include <stdexcept>
+using namespace ariel;
+using namespace std;
+
+// Virtual destructor for StorageBackend
+StorageBackend::~StorageBackend()
+{
+}
+
+// Backends store any value unless they override this
+bool StorageBackend::accepts(int) const
+{
+    return true;
+}
+
+// Backends leave the primes to a separate store unless they override this
+bool StorageBackend::tracksPrimes() const
+{
+    return false;
+}
+
+// Returns the number of stored primes
+size_t StorageBackend::primeSize() const
+{
+    throw std::logic_error("This storage backend does not track primes.");
+}
+
+// Returns the k-th smallest stored prime
+int StorageBackend::primeSelect(size_t) const
+{
+    throw std::logic_error("This storage backend does not track primes.");
+}
+
+// Returns the number of stored primes smaller than value
+size_t StorageBackend::primeRank(int) const
+{
+    throw std::logic_error("This storage backend does not track primes.");
+}
+
+//*****BackendHandle*****
+
+// Default constructor for BackendHandle, holds no backend
+BackendHandle::BackendHandle()
+{
+}
+
+// Takes ownership of the given backend
+BackendHandle::BackendHandle(unique_ptr<StorageBackend> backend) : backend(std::move(backend))
+{
+}
+
+// Copy constructor for BackendHandle, clones the backend
+BackendHandle::BackendHandle(const BackendHandle &other)
+    : backend(other.backend ? other.backend->clone() : nullptr)
+{
+}
+
+// Move constructor for BackendHandle
+BackendHandle::BackendHandle(BackendHandle &&other) noexcept : backend(std::move(other.backend))
+{
+}
+
+// Destructor for BackendHandle
+BackendHandle::~BackendHandle()
+{
+}
+
+// Assignment operator for BackendHandle, clones the backend
+BackendHandle &BackendHandle::operator=(const BackendHandle &other)
+{
+    if (this != &other)
+    {
+        backend = other.backend ? other.backend->clone() : nullptr;
+    }
+    return *this;
+}
+
+// Move assignment operator for BackendHandle
+BackendHandle &BackendHandle::operator=(BackendHandle &&other) noexcept
+{
+    backend = std::move(other.backend);
+    return *this;
+}
+
+// Member access to the held backend
+StorageBackend *BackendHandle::operator->() const
+{
+    return backend.get();
+}
+
+// Dereference to the held backend
+StorageBackend &BackendHandle::operator*() const
+{
+    return *backend;
+}
+
+// Returns true if a backend is held
+BackendHandle::operator bool() const
+{
+    return backend != nullptr;
+}
@@ -0,0 +1,83 @@
+#ifndef STORAGEBACKEND_HPP
+#define STORAGEBACKEND_HPP
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+using namespace std;
+
+namespace ariel
+{
+    // Interface of the alternative storage layouts a MagicalContainer can keep its elements in.
+    // A backend holds a sorted multiset of integers and answers positional queries on it.
+    class StorageBackend
+    {
+    public:
+        virtual ~StorageBackend();
+
+        // Returns a deep copy of the backend.
+        virtual unique_ptr<StorageBackend> clone() const = 0;
+
+        // Replaces the contents with the given sorted values.
+        virtual void assign(const vector<int> &sorted) = 0;
+
+        // Inserts one copy of value.
+        virtual void insert(int value) = 0;
+
+        // Removes one copy of value; returns false if it is missing.
+        virtual bool erase(int value) = 0;
+
+        // Returns the number of stored values.
+        virtual size_t size() const = 0;
+
+        // Returns the k-th smallest value (0-based); k must be smaller than size().
+        virtual int select(size_t k) const = 0;
+
+        // Returns the number of stored values smaller than value.
+        virtual size_t rank(int value) const = 0;
+
+        // Appends every stored value to out in ascending order.
+        virtual void appendTo(vector<int> &out) const = 0;
+
+        // Returns the approximate number of bytes the layout occupies.
+        virtual size_t memoryUsage() const = 0;
+
+        // Returns true if insert(value) can succeed. True by default.
+        virtual bool accepts(int value) const;
+
+        // Returns true if the backend answers the prime queries below itself, so that the
+        // container keeps no separate store of the prime elements. False by default.
+        virtual bool tracksPrimes() const;
+
+        // Prime-restricted size, select and rank; only valid when tracksPrimes() is true.
+        virtual size_t primeSize() const;
+        virtual int primeSelect(size_t k) const;
+        virtual size_t primeRank(int value) const;
+    };
+
+    // Owning handle to a backend that deep-copies it, so containers holding one stay copyable.
+    class BackendHandle
+    {
+    private:
+        unique_ptr<StorageBackend> backend;
+
+    public:
+        BackendHandle();
+        BackendHandle(unique_ptr<StorageBackend> backend);
+        BackendHandle(const BackendHandle &other);
+        BackendHandle(BackendHandle &&other) noexcept;
+        ~BackendHandle();
+
+        BackendHandle &operator=(const BackendHandle &other);
+        BackendHandle &operator=(BackendHandle &&other) noexcept;
+
+        StorageBackend *operator->() const;
+        StorageBackend &operator*() const;
+
+        // Returns true if a backend is held.
+        explicit operator bool() const;
+    };
+}
+
+#endif // STORAGEBACKEND_HPP
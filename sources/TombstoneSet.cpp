@@ -0,0 +1,66 @@
+#include "TombstoneSet.hpp"
+using namespace ariel;
+using namespace std;
+
+// Default constructor for TombstoneSet, tracks no slots
+TombstoneSet::TombstoneSet() : deadSlots(0)
+{
+}
+
+// Marks count slots, all of them live
+void TombstoneSet::reset(size_t count)
+{
+    deadBits.assign((count + 63) / 64, 0);
+    liveCounts.assign(vector<long long>(count, 1));
+    deadSlots = 0;
+}
+
+// Appends one live slot
+void TombstoneSet::appendLive()
+{
+    if (liveCounts.size() % 64 == 0)
+    {
+        deadBits.push_back(0);
+    }
+    liveCounts.push_back(1);
+}
+
+// Marks a live slot as deleted
+void TombstoneSet::kill(size_t slot)
+{
+    deadBits[slot / 64] |= uint64_t{1} << (slot % 64);
+    liveCounts.add(slot, -1);
+    ++deadSlots;
+}
+
+// Returns true if the slot was deleted
+bool TombstoneSet::isDead(size_t slot) const
+{
+    return ((deadBits[slot / 64] >> (slot % 64)) & 1) != 0;
+}
+
+// Returns the number of live slots in [0, slot)
+size_t TombstoneSet::liveBefore(size_t slot) const
+{
+    if (deadSlots == 0)
+    {
+        return slot;
+    }
+    return static_cast<size_t>(liveCounts.prefixSum(slot));
+}
+
+// Returns the slot holding the k-th live entry
+size_t TombstoneSet::slotOfLive(size_t k) const
+{
+    if (deadSlots == 0)
+    {
+        return k;
+    }
+    return liveCounts.searchPrefix(static_cast<long long>(k) + 1) - 1;
+}
+
+// Returns the number of dead slots
+size_t TombstoneSet::deadCount() const
+{
+    return deadSlots;
+}
@@ -0,0 +1,48 @@
+#ifndef TOMBSTONESET_HPP
+#define TOMBSTONESET_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "FenwickTree.hpp"
+
+using namespace std;
+
+namespace ariel
+{
+    // Deletion marks over the slots of an array, with a count of live slots per prefix,
+    // so that logical positions (live slots only) and physical slots convert in O(log n).
+    class TombstoneSet
+    {
+    private:
+        vector<uint64_t> deadBits;// One bit per slot, set once the slot is deleted
+        FenwickTree liveCounts;// 1 for every live slot, 0 for every dead one
+        size_t deadSlots;// Number of set bits in deadBits
+
+    public:
+        TombstoneSet();
+
+        // Marks count slots, all of them live.
+        void reset(size_t count);
+
+        // Appends one live slot in O(log n).
+        void appendLive();
+
+        // Marks a live slot as deleted.
+        void kill(size_t slot);
+
+        // Returns true if the slot was deleted.
+        bool isDead(size_t slot) const;
+
+        // Returns the number of live slots in [0, slot).
+        size_t liveBefore(size_t slot) const;
+
+        // Returns the slot holding the k-th live entry (0-based).
+        size_t slotOfLive(size_t k) const;
+
+        // Returns the number of dead slots.
+        size_t deadCount() const;
+    };
+}
+
+#endif // TOMBSTONESET_HPP